@@ -8,16 +8,28 @@
 #include "Components/SceneComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "GameFramework/WorldSettings.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "PilotRewindSubsystem.h"
+#include "PilotWorkScheduler.h"
 #include "TimerManager.h"
+#include "TF2PilotMovement.h"
 
 #include "DrawDebugHelpers.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
 
 // Sets default values
 ABaseCharacter::ABaseCharacter() :
 	// Setup
+	Archetype(EPilotArchetype::PA_Custom),
 	bAutoSprint(true),
+	bEnableSlideBoost(true),
+	bEnableDoubleJump(true),
 	DefaultFOV(110.f),
 	SlideFOVOffset(5.f),
 	SlideFOV(0.f),
@@ -27,6 +39,12 @@ ABaseCharacter::ABaseCharacter() :
 	WallrunSpeed(863.6f),
 	CapsuleInterpSpeed(10.f),
 	CrouchCapsuleHalfHeight(60.f),
+	CapsuleCommitThreshold(2.f),
+	CapsuleCommitInterval(.05f),
+	VisualCapsuleHalfHeight(0.f),
+	CapsuleCommitTimer(0.f),
+	bCanStandUp(true),
+	StandUpRetryTimer(0.f),
 	SlideBoostResetTime(2.f),
 	SlideBoostForce(200.f),
 	SlideCameraTiltAngle(15.f),
@@ -34,6 +52,10 @@ ABaseCharacter::ABaseCharacter() :
 	SlideBrakingDeceleration(200.f),
 	JumpZForce(625.f),
 	InstantJumpMultiplier(.88f),
+	bRecordTelemetry(false),
+	TelemetryCapacity(4096),
+	bMeasureInputLatency(false),
+	bApplyDiscreteInputImmediately(false),
 	// Status
 	bInputForward(false),
 	bPrevInputForward(false),
@@ -43,16 +65,21 @@ ABaseCharacter::ABaseCharacter() :
 	bIsAccelForward(false),
 	bIsSprinting(false),
 	bWalkSprintInput(false),
-	bIsWallrunning(false),
 	bIsCrouching(false),
-	bIsSliding(false),
 	bCanSlideBoost(true),
-	bIsJumping(false),
 	bCanMaxJump(true),
 	bCanDoubleJump(true),
+	bIsWallrunning(false),
+	bIsSliding(false),
+	bIsJumping(false),
 	MovementStatus(EMovementStatus::MS_Land),
+	InvalidMovementStatusTransitions(0),
+	MovementRules(&FindMovementRules(EPilotArchetype::PA_Custom)),
 	SlideDirection(FVector::ZeroVector),
-	DefaultMaxAcceleration(4096)
+	DefaultMaxAcceleration(4096),
+	WorkScheduler(nullptr),
+	PendingTelemetryEvents(EPilotTelemetryEvent::None),
+	CapsuleStepFrame(MAX_uint64)
 {
 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -75,12 +102,42 @@ ABaseCharacter::ABaseCharacter() :
 	Arm->SetupAttachment(CameraComponent);
 
 	// CharacterMovementComponent Setup
-	GetCharacterMovement()->SetCrouchedHalfHeight(50.f);
 	GetCharacterMovement()->MaxAcceleration = 4096.f;
 	GetCharacterMovement()->PerchRadiusThreshold = 25.f;
 	GetCharacterMovement()->bUseFlatBaseForFloorChecks = true;
 }
 
+namespace PilotMovementPolicy
+{
+	// Rules fixed at compile time, the pilot's runtime flag is ignored so the branch folds away.
+	template <bool bInAutoSprint, bool bInSlideBoost, bool bInDoubleJump>
+	struct TFixed
+	{
+		static constexpr bool AutoSprint(bool) { return bInAutoSprint; }
+		static constexpr bool SlideBoost(bool) { return bInSlideBoost; }
+		static constexpr bool DoubleJump(bool) { return bInDoubleJump; }
+	};
+
+	struct FCustom
+	{
+		static bool AutoSprint(bool bAutoSprint) { return bAutoSprint; }
+		static bool SlideBoost(bool bEnableSlideBoost) { return bEnableSlideBoost; }
+		static bool DoubleJump(bool bEnableDoubleJump) { return bEnableDoubleJump; }
+	};
+
+	using FStandard = TFixed<true, true, true>;
+	using FToggleSprint = TFixed<false, true, true>;
+	using FGrounded = TFixed<true, false, false>;
+}
+
+void ABaseCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Before input is bound, so the bindings go straight to the specialized handlers.
+	MovementRules = &FindMovementRules(Archetype);
+}
+
 // Called when the game starts or when spawned
 void ABaseCharacter::BeginPlay()
 {
@@ -92,24 +149,91 @@ void ABaseCharacter::BeginPlay()
 	// GetCharacterMovement()->bCrouchMaintainsBaseLocation = true;
 
 	DefaultCapsuleHalfHeight = GetDefaultHalfHeight();
+	VisualCapsuleHalfHeight = GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	GetCharacterMovement()->SetCrouchedHalfHeight(CrouchCapsuleHalfHeight);
 	DefaultGroundFriction = GetCharacterMovement()->GroundFriction;
 	DefaultBrakingDeceleration = GetCharacterMovement()->BrakingDecelerationWalking;
+	DefaultMaxAcceleration = GetCharacterMovement()->MaxAcceleration;
+
+	if (bRecordTelemetry)
+	{
+		const FString FilePath = FPaths::Combine(
+			FPaths::ProjectSavedDir(),
+			TEXT("Telemetry"),
+			FString::Printf(TEXT("%s_%s.pmt"), *GetName(), *FDateTime::Now().ToString())
+		);
+		Telemetry.Start(TelemetryCapacity, FilePath);
+	}
+	if (bMeasureInputLatency)
+	{
+		OnCharacterMovementUpdated.AddDynamic(this, &ABaseCharacter::MeasureInputLatency);
+	}
+
+	WorkScheduler = GetWorld()->GetSubsystem<UPilotWorkScheduler>();
+	if (WorkScheduler)
+	{
+		WorkScheduler->RegisterPilot(this);
+	}
+	if (UPilotRewindSubsystem* RewindSubsystem = GetWorld()->GetSubsystem<UPilotRewindSubsystem>())
+	{
+		RewindSubsystem->RegisterPilot(this);
+	}
+}
+
+void ABaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRecordTelemetry)
+	{
+		ExportMovementTelemetry();
+	}
+	if (bMeasureInputLatency)
+	{
+		InputLatency.LogHistograms(GetName());
+	}
+	if (WorkScheduler)
+	{
+		WorkScheduler->UnregisterPilot(this);
+		WorkScheduler = nullptr;
+	}
+	if (UPilotRewindSubsystem* RewindSubsystem = GetWorld()->GetSubsystem<UPilotRewindSubsystem>())
+	{
+		RewindSubsystem->UnregisterPilot(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABaseCharacter::MoveForward()
 {
+	(this->*MovementRules->MoveForward)();
+}
+
+template <typename Policy>
+void ABaseCharacter::MoveForwardImpl()
+{
+	if (bMeasureInputLatency)
+	{
+		InputLatency.MarkInput(EPilotLatencyAction::MoveForward, VisualCapsuleHalfHeight);
+	}
+
 	bInputForward = true;
-	if (bAutoSprint && 
+	if (Policy::AutoSprint(bAutoSprint) &&
 		MovementStatus == EMovementStatus::MS_Land &&
-		!bIsCrouching &&
-		!bIsSliding)
+		!IsCrouchedForMovement())
 	{
 		bIsSprinting = true;
 	}
+
+	if (bApplyDiscreteInputImmediately)
+	{
+		ApplyDiscreteInput();
+	}
 }
 
 void ABaseCharacter::MoveForwardStop()
 {
+	// Released before it moved the pilot, e.g. already at max speed, so there is no latency to measure.
+	InputLatency.CancelInput(EPilotLatencyAction::MoveForward);
 	bInputForward = false;
 	bIsSprinting = false;
 }
@@ -145,9 +269,15 @@ void ABaseCharacter::MoveLeftStop()
 }
 
 void ABaseCharacter::MoveForwardAxis(float Value)
+{
+	(this->*MovementRules->MoveForwardAxis)(Value);
+}
+
+template <typename Policy>
+void ABaseCharacter::MoveForwardAxisImpl(float Value)
 {
 	bIsAccelForward = Value > 0.f ? true : false;
-	if (bAutoSprint && !bWalkSprintInput && !bIsCrouching)
+	if (Policy::AutoSprint(bAutoSprint) && !bWalkSprintInput && !IsCrouchedForMovement())
 	{
 		bIsSprinting = Value >= 0.95f ? true : false;
 	}
@@ -167,8 +297,12 @@ void ABaseCharacter::CustomJump()
 	{
 		return;
 	}
+	if (bMeasureInputLatency)
+	{
+		InputLatency.MarkInput(EPilotLatencyAction::Jump, VisualCapsuleHalfHeight);
+	}
 
-	FVector JumpDirection;
+	FVector JumpDirection = FVector::ZeroVector;
 	if (MovementStatus == EMovementStatus::MS_Wallrun)
 	{
 		// Wall jump
@@ -181,6 +315,7 @@ void ABaseCharacter::CustomJump()
 		{
 			// DoubleJump
 			bCanDoubleJump = false;
+			PendingTelemetryEvents |= EPilotTelemetryEvent::DoubleJump;
 		}
 		else
 		{
@@ -188,6 +323,11 @@ void ABaseCharacter::CustomJump()
 			if (!bCanMaxJump)
 			{
 				JumpDirection.Z *= InstantJumpMultiplier;
+				PendingTelemetryEvents |= EPilotTelemetryEvent::InstantJump;
+			}
+			else
+			{
+				PendingTelemetryEvents |= EPilotTelemetryEvent::MaxJump;
 			}
 			if (GetWorldTimerManager().IsTimerActive(MaxJumpTimer))
 			{
@@ -198,13 +338,8 @@ void ABaseCharacter::CustomJump()
 	LaunchCharacter(JumpDirection, false, true);
 	SetMovementStatus(EMovementStatus::MS_JumpBeforeApex);
 	GetCharacterMovement()->bNotifyApex = true;
-	bIsJumping = true;
 	bCanMaxJump = false;
 	bIsSprinting = false;
-	if (bIsSliding)
-	{
-		StopSlide();
-	}
 
 	ShakeCamera();
 }
@@ -216,33 +351,69 @@ void ABaseCharacter::ActivateMaxJump()
 
 bool ABaseCharacter::CustomCanJump() const
 {
-	if (MovementStatus == EMovementStatus::MS_Fall)
+	return (this->*MovementRules->CustomCanJump)();
+}
+
+template <typename Policy>
+bool ABaseCharacter::CustomCanJumpImpl() const
+{
+	if (MovementStatus == EMovementStatus::MS_Fall || MovementStatus == EMovementStatus::MS_JumpBeforeApex)
 	{
-		return bCanDoubleJump;
+		return Policy::DoubleJump(bEnableDoubleJump) && bCanDoubleJump;
 	}
 	return true;
 }
 
 void ABaseCharacter::CustomStartCrouch()
 {
+	if (bMeasureInputLatency)
+	{
+		InputLatency.MarkInput(EPilotLatencyAction::Crouch, VisualCapsuleHalfHeight);
+	}
+
 	bIsCrouching = true;
 	bIsSprinting = false;
+	// Standing up needs a fresh room check, done on the first frame after release.
+	bCanStandUp = false;
+	StandUpRetryTimer = 0.f;
 
 	if (CanSlide())
 	{
-		StartSlide();
+		SetMovementStatus(EMovementStatus::MS_Slide);
+	}
+
+	if (bApplyDiscreteInputImmediately)
+	{
+		ApplyDiscreteInput();
 	}
 }
 
 void ABaseCharacter::CustomStopCrouch()
 {
+	InputLatency.CancelInput(EPilotLatencyAction::Crouch);
 	bIsCrouching = false;
 
-	if (bIsSliding)
+	if (MovementStatus == EMovementStatus::MS_Slide)
+	{
+		SetMovementStatus(EMovementStatus::MS_Land);
+	}
+	// Sprint resumes once InterpCapsuleHalfHeight finds room to stand up.
+
+	if (bApplyDiscreteInputImmediately)
 	{
-		StopSlide();
+		ApplyDiscreteInput();
 	}
-	if (bAutoSprint && bInputForward)
+}
+
+void ABaseCharacter::ResumeAutoSprint()
+{
+	(this->*MovementRules->ResumeAutoSprint)();
+}
+
+template <typename Policy>
+void ABaseCharacter::ResumeAutoSprintImpl()
+{
+	if (Policy::AutoSprint(bAutoSprint) && bInputForward && !IsCrouchedForMovement())
 	{
 		bIsSprinting = true;
 	}
@@ -251,44 +422,266 @@ void ABaseCharacter::CustomStopCrouch()
 void ABaseCharacter::SprintOrWalk()
 {
 	bWalkSprintInput = !bWalkSprintInput;
-	if (bInputForward)
+	if (bInputForward && !IsCrouchedForMovement())
 	{
 		bIsSprinting = !bIsSprinting;
 	}
 }
 
+namespace MovementStatusTransition
+{
+	constexpr int32 NumStatuses = static_cast<int32>(EMovementStatus::DefaultMax);
+
+	// Rows are the current status, columns the new one.
+	constexpr bool Allowed[NumStatuses][NumStatuses] =
+	{
+		//						Land	Wallrun	Fall	JumpBeforeApex	Slide
+		/* Land */				{ true,	false,	true,	true,			true },
+		/* Wallrun */			{ true,	true,	true,	true,			false },
+		/* Fall */				{ true,	true,	true,	true,			false },
+		/* JumpBeforeApex */	{ true,	true,	true,	true,			false },
+		/* Slide */				{ true,	false,	true,	true,			true },
+	};
+
+	enum class EAction : uint8
+	{
+		None,
+		EnterLand,
+		StartSlide,
+		StopSlide,
+	};
+
+	struct FStatusActions
+	{
+		EAction OnEnter;
+		EAction OnExit;
+	};
+
+	constexpr FStatusActions Actions[NumStatuses] =
+	{
+		/* Land */				{ EAction::EnterLand,	EAction::None },
+		/* Wallrun */			{ EAction::None,		EAction::None },
+		/* Fall */				{ EAction::None,		EAction::None },
+		/* JumpBeforeApex */	{ EAction::None,		EAction::None },
+		/* Slide */				{ EAction::StartSlide,	EAction::StopSlide },
+	};
+
+	constexpr bool IsAllowed(EMovementStatus From, EMovementStatus To)
+	{
+		return From < EMovementStatus::DefaultMax &&
+			To < EMovementStatus::DefaultMax &&
+			Allowed[static_cast<int32>(From)][static_cast<int32>(To)];
+	}
+
+	enum class EResult : uint8
+	{
+		Unchanged,
+		Rejected,
+		Changed,
+	};
+
+	struct FTransition
+	{
+		EResult Result;
+		EAction Exit;
+		EAction Enter;
+	};
+
+	// Everything SetMovementStatus does for a status change, minus running the actions.
+	constexpr FTransition Resolve(EMovementStatus From, EMovementStatus To)
+	{
+		if (From == To)
+		{
+			return { EResult::Unchanged, EAction::None, EAction::None };
+		}
+		if (!IsAllowed(From, To))
+		{
+			return { EResult::Rejected, EAction::None, EAction::None };
+		}
+		return { EResult::Changed, Actions[static_cast<int32>(From)].OnExit, Actions[static_cast<int32>(To)].OnEnter };
+	}
+
+	constexpr bool IsGrounded(EMovementStatus Status)
+	{
+		return Status == EMovementStatus::MS_Land || Status == EMovementStatus::MS_Slide;
+	}
+
+	// The movement rules the table encodes: slide only starts on the ground, wallrun only from the air,
+	// and landing, falling and jumping are reachable from everywhere.
+	constexpr bool IsExpected(EMovementStatus From, EMovementStatus To)
+	{
+		if (From == To)
+		{
+			return true;
+		}
+		switch (To)
+		{
+		case EMovementStatus::MS_Slide:
+			return From == EMovementStatus::MS_Land;
+		case EMovementStatus::MS_Wallrun:
+			return !IsGrounded(From);
+		case EMovementStatus::MS_Land:
+		case EMovementStatus::MS_Fall:
+		case EMovementStatus::MS_JumpBeforeApex:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	constexpr bool MatchesMovementRules()
+	{
+		for (int32 From = 0; From <= NumStatuses; ++From)
+		{
+			for (int32 To = 0; To <= NumStatuses; ++To)
+			{
+				const EMovementStatus FromStatus = static_cast<EMovementStatus>(From);
+				const EMovementStatus ToStatus = static_cast<EMovementStatus>(To);
+				const bool bInRange = From < NumStatuses && To < NumStatuses;
+				if (IsAllowed(FromStatus, ToStatus) != (bInRange && IsExpected(FromStatus, ToStatus)))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Setting the current status again does nothing, not even the status's own actions.
+	constexpr bool SameStatusIsNoOp()
+	{
+		for (int32 Status = 0; Status < NumStatuses; ++Status)
+		{
+			const FTransition Transition = Resolve(static_cast<EMovementStatus>(Status), static_cast<EMovementStatus>(Status));
+			if (Transition.Result != EResult::Unchanged || Transition.Exit != EAction::None || Transition.Enter != EAction::None)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Every transition the rules forbid is counted as rejected and runs no actions.
+	constexpr bool ForbiddenTransitionsAreRejected()
+	{
+		for (int32 From = 0; From < NumStatuses; ++From)
+		{
+			for (int32 To = 0; To <= NumStatuses; ++To)
+			{
+				const EMovementStatus FromStatus = static_cast<EMovementStatus>(From);
+				const EMovementStatus ToStatus = static_cast<EMovementStatus>(To);
+				if (From == To || (To < NumStatuses && IsExpected(FromStatus, ToStatus)))
+				{
+					continue;
+				}
+				const FTransition Transition = Resolve(FromStatus, ToStatus);
+				if (Transition.Result != EResult::Rejected || Transition.Exit != EAction::None || Transition.Enter != EAction::None)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	constexpr bool RunsActions(EMovementStatus From, EMovementStatus To, EAction Exit, EAction Enter)
+	{
+		const FTransition Transition = Resolve(From, To);
+		return Transition.Result == EResult::Changed && Transition.Exit == Exit && Transition.Enter == Enter;
+	}
+
+	static_assert(MatchesMovementRules(), "Movement status transition table doesn't match the movement rules");
+	static_assert(SameStatusIsNoOp(), "Setting the same movement status must do nothing");
+	static_assert(ForbiddenTransitionsAreRejected(), "Forbidden movement status transitions must be rejected without actions");
+	static_assert(RunsActions(EMovementStatus::MS_Land, EMovementStatus::MS_Slide, EAction::None, EAction::StartSlide), "Land -> Slide must start the slide");
+	static_assert(RunsActions(EMovementStatus::MS_Slide, EMovementStatus::MS_Fall, EAction::StopSlide, EAction::None), "Slide -> Fall must stop the slide");
+	static_assert(RunsActions(EMovementStatus::MS_Slide, EMovementStatus::MS_JumpBeforeApex, EAction::StopSlide, EAction::None), "Jumping out of a slide must stop it");
+	static_assert(RunsActions(EMovementStatus::MS_Slide, EMovementStatus::MS_Land, EAction::StopSlide, EAction::EnterLand), "Slide -> Land must stop the slide and land");
+	static_assert(RunsActions(EMovementStatus::MS_Fall, EMovementStatus::MS_Land, EAction::None, EAction::EnterLand), "Landing must restore the double jump");
+	static_assert(RunsActions(EMovementStatus::MS_Land, EMovementStatus::MS_JumpBeforeApex, EAction::None, EAction::None), "Land -> JumpBeforeApex runs no actions");
+}
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Invalid Status Transitions"), STAT_PilotInvalidStatusTransitions, STATGROUP_PilotMovement);
+
 void ABaseCharacter::SetMovementStatus(EMovementStatus NewStatus)
 {
-	switch (NewStatus)
+	using namespace MovementStatusTransition;
+
+	const FTransition Transition = Resolve(MovementStatus, NewStatus);
+	if (Transition.Result == EResult::Unchanged)
 	{
-	case EMovementStatus::MS_Land:
-		break;
-	case EMovementStatus::MS_Wallrun:
-		break;
-	case EMovementStatus::MS_Fall:
-		break;
-	case EMovementStatus::MS_JumpBeforeApex:
-		break;
-	case EMovementStatus::DefaultMax:
-		break;
+		return;
+	}
+	if (Transition.Result == EResult::Rejected)
+	{
+		++InvalidMovementStatusTransitions;
+		INC_DWORD_STAT(STAT_PilotInvalidStatusTransitions);
+		return;
 	}
 
+	auto RunAction = [this](EAction Action)
+	{
+		switch (Action)
+		{
+		case EAction::EnterLand:
+			EnterLand();
+			break;
+		case EAction::StartSlide:
+			StartSlide();
+			break;
+		case EAction::StopSlide:
+			StopSlide();
+			break;
+		default:
+			break;
+		}
+	};
+
+	RunAction(Transition.Exit);
+
 	MovementStatus = NewStatus;
+	bIsWallrunning = NewStatus == EMovementStatus::MS_Wallrun;
+	bIsSliding = NewStatus == EMovementStatus::MS_Slide;
+	if (NewStatus == EMovementStatus::MS_JumpBeforeApex)
+	{
+		bIsJumping = true;
+	}
+	else if (IsGrounded(NewStatus))
+	{
+		bIsJumping = false;
+	}
+
+	RunAction(Transition.Enter);
+}
+
+void ABaseCharacter::EnterLand()
+{
+	bCanDoubleJump = true;
 }
 
 float ABaseCharacter::GetCurrentMaxSpeed() const
 {
-	if (bIsCrouching)
+	if (IsCrouchedForMovement())
 	{
 		return CrouchSpeed;
 	}
-	if (bIsWallrunning)
+	if (MovementStatus == EMovementStatus::MS_Wallrun)
 	{
 		return WallrunSpeed;
 	}
 	return bIsSprinting ? SprintSpeed : WalkSpeed;
 }
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Capsule Shape Updates"), STAT_PilotCapsuleShapeUpdates, STATGROUP_PilotMovement);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stand Up Queries"), STAT_PilotStandUpQueries, STATGROUP_PilotMovement);
+
+static TAutoConsoleVariable<bool> CVarPilotCapsuleCommitEveryFrame(
+	TEXT("pilot.CapsuleCommitEveryFrame"),
+	false,
+	TEXT("Push every interpolated crouch height to the collision capsule, as before commits were rate limited. For comparing Capsule Shape Updates in stat PilotMovement."),
+	ECVF_Default
+);
+
 void ABaseCharacter::InterpCapsuleHalfHeight(float DeltaTime)
 {
 	const float CurrentHalfHeight = GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
@@ -302,24 +695,107 @@ void ABaseCharacter::InterpCapsuleHalfHeight(float DeltaTime)
 		TargetHalfHeight = DefaultCapsuleHalfHeight;
 	}
 
-	const float NextHalfHeight = FMath::FInterpTo(CurrentHalfHeight, TargetHalfHeight, DeltaTime, CapsuleInterpSpeed);
-	const float DeltaHalfHeight = NextHalfHeight - CurrentHalfHeight;
-	GetCapsuleComponent()->SetCapsuleHalfHeight(NextHalfHeight);
+	if (VisualCapsuleHalfHeight == TargetHalfHeight && CurrentHalfHeight == TargetHalfHeight)
+	{
+		if (!bCanStandUp && !bIsCrouching)
+		{
+			// Crouch released before the capsule moved, there is nothing to stand up from.
+			StandUp();
+		}
+		return;
+	}
+
+	CapsuleCommitTimer += DeltaTime;
 
-	CameraPitchControlBase->AddLocalOffset(FVector(0.f, 0.f, DeltaHalfHeight));
+	// Check for room as soon as crouch is released, retry at the commit rate while something is overhead.
+	if (!bCanStandUp && !bIsCrouching)
+	{
+		StandUpRetryTimer -= DeltaTime;
+		if (StandUpRetryTimer > 0.f)
+		{
+			return;
+		}
+		if (!CanStandUp())
+		{
+			StandUpRetryTimer = CapsuleCommitInterval;
+			return;
+		}
+		StandUp();
+	}
+
+	float NextHalfHeight = FMath::FInterpTo(VisualCapsuleHalfHeight, TargetHalfHeight, DeltaTime, CapsuleInterpSpeed);
+	if (FMath::IsNearlyEqual(NextHalfHeight, TargetHalfHeight, .1f))
+	{
+		NextHalfHeight = TargetHalfHeight;
+	}
+	CameraPitchControlBase->AddLocalOffset(FVector(0.f, 0.f, NextHalfHeight - VisualCapsuleHalfHeight));
+	VisualCapsuleHalfHeight = NextHalfHeight;
+
+	// The collision shape follows at a reduced rate, and always lands exactly on the target.
+	const bool bReachedTarget = VisualCapsuleHalfHeight == TargetHalfHeight;
+	const bool bCommitDue = CVarPilotCapsuleCommitEveryFrame.GetValueOnGameThread() || (
+		CapsuleCommitTimer >= CapsuleCommitInterval &&
+		FMath::Abs(VisualCapsuleHalfHeight - CurrentHalfHeight) >= CapsuleCommitThreshold
+	);
+	if ((bReachedTarget && CurrentHalfHeight != TargetHalfHeight) || bCommitDue)
+	{
+		CommitCapsuleHalfHeight(VisualCapsuleHalfHeight);
+	}
 
 	// TODO: Set WallrunDetector height
 }
 
+void ABaseCharacter::CommitCapsuleHalfHeight(float HalfHeight)
+{
+	INC_DWORD_STAT(STAT_PilotCapsuleShapeUpdates);
+
+	GetCapsuleComponent()->SetCapsuleHalfHeight(HalfHeight);
+	CapsuleCommitTimer = 0.f;
+}
+
+void ABaseCharacter::StandUp()
+{
+	bCanStandUp = true;
+	ResumeAutoSprint();
+}
+
+bool ABaseCharacter::CanStandUp() const
+{
+	INC_DWORD_STAT(STAT_PilotStandUpQueries);
+
+	const UCapsuleComponent* Capsule = GetCapsuleComponent();
+	const float CurrentHalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+
+	// Standing capsule with the feet where they are now, lifted slightly off the floor.
+	const float StandingHalfHeight = DefaultCapsuleHalfHeight - 1.f;
+	const FVector StandingCenter = GetActorLocation() + FVector(0.f, 0.f, StandingHalfHeight - CurrentHalfHeight + 2.f);
+	const FCollisionShape StandingShape = FCollisionShape::MakeCapsule(Capsule->GetScaledCapsuleRadius() - 1.f, StandingHalfHeight);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(PilotStandUp), false, this);
+	FCollisionResponseParams ResponseParams;
+	GetCharacterMovement()->InitCollisionParams(QueryParams, ResponseParams);
+
+	return !GetWorld()->OverlapBlockingTestByChannel(
+		StandingCenter,
+		FQuat::Identity,
+		Capsule->GetCollisionObjectType(),
+		StandingShape,
+		QueryParams,
+		ResponseParams
+	);
+}
+
 void ABaseCharacter::ReachedJumpApex()
 {
-	UE_LOG(LogTemp, Warning, TEXT("In Apex"));
-	SetMovementStatus(EMovementStatus::MS_Fall);
+	if (MovementStatus == EMovementStatus::MS_JumpBeforeApex)
+	{
+		SetMovementStatus(EMovementStatus::MS_Fall);
+	}
 }
 
 bool ABaseCharacter::CanSlide() const
 {
-	if (bIsCrouching && MovementStatus == EMovementStatus::MS_Land && GetVelocityXYKPH() > 20.f)
+	if (bIsCrouching && MovementStatus == EMovementStatus::MS_Land && GetVelocityXYKPH() > SlideStartSpeedKPH)
 	{
 		return true;
 	}
@@ -328,11 +804,12 @@ bool ABaseCharacter::CanSlide() const
 
 void ABaseCharacter::StartSlide()
 {
-	if (bIsSliding)
-	{
-		return;
-	}
+	(this->*MovementRules->StartSlide)();
+}
 
+template <typename Policy>
+void ABaseCharacter::StartSlideImpl()
+{
 	// TODO: Reduce input accel
 	GetCharacterMovement()->MaxAcceleration *= GetCharacterMovement()->AirControl;
 	GetCharacterMovement()->GroundFriction = SlideGroundFriction;
@@ -341,9 +818,9 @@ void ABaseCharacter::StartSlide()
 	SlideDirection = GetCharacterMovement()->GetLastUpdateVelocity();
 	SlideDirection.Z = 0.f;
 	SlideDirection.Normalize();
-	bIsSliding = true;
+	PendingTelemetryEvents |= EPilotTelemetryEvent::SlideStart;
 
-	if (bCanSlideBoost)
+	if (Policy::SlideBoost(bEnableSlideBoost) && bCanSlideBoost)
 	{
 		GetCharacterMovement()->AddImpulse(
 			SlideDirection * SlideBoostForce,
@@ -360,11 +837,6 @@ void ABaseCharacter::StartSlide()
 
 void ABaseCharacter::StopSlide()
 {
-	if (!bIsSliding)
-	{
-		return;
-	}
-
 	GetWorldTimerManager().SetTimer(
 		SlideBoostResetTimer,
 		this,
@@ -377,7 +849,109 @@ void ABaseCharacter::StopSlide()
 	GetCharacterMovement()->BrakingDecelerationWalking = DefaultBrakingDeceleration;
 
 	SlideDirection = FVector::ZeroVector;
-	bIsSliding = false;
+	PendingTelemetryEvents |= EPilotTelemetryEvent::SlideStop;
+}
+
+template <typename Policy>
+ABaseCharacter::FPilotMovementRules ABaseCharacter::MakeMovementRules()
+{
+	return {
+		&ABaseCharacter::MoveForwardImpl<Policy>,
+		&ABaseCharacter::MoveForwardAxisImpl<Policy>,
+		&ABaseCharacter::CustomCanJumpImpl<Policy>,
+		&ABaseCharacter::StartSlideImpl<Policy>,
+		&ABaseCharacter::ResumeAutoSprintImpl<Policy>,
+		&ABaseCharacter::GetTrajectoryRulesImpl<Policy>
+	};
+}
+
+const ABaseCharacter::FPilotMovementRules& ABaseCharacter::FindMovementRules(EPilotArchetype InArchetype)
+{
+	static const FPilotMovementRules Registry[] =
+	{
+		/* Custom */		MakeMovementRules<PilotMovementPolicy::FCustom>(),
+		/* Standard */		MakeMovementRules<PilotMovementPolicy::FStandard>(),
+		/* ToggleSprint */	MakeMovementRules<PilotMovementPolicy::FToggleSprint>(),
+		/* Grounded */		MakeMovementRules<PilotMovementPolicy::FGrounded>(),
+	};
+	static_assert(UE_ARRAY_COUNT(Registry) == static_cast<int32>(EPilotArchetype::DefaultMax), "Missing pilot archetype rules");
+
+	const int32 Index = static_cast<int32>(InArchetype);
+	return Registry[Index < static_cast<int32>(EPilotArchetype::DefaultMax) ? Index : 0];
+}
+
+static FAutoConsoleCommandWithWorldAndArgs PilotBenchmarkMovementRulesCommand(
+	TEXT("pilot.BenchmarkMovementRules"),
+	TEXT("Times every archetype's input handlers, and the archetype independent tick input path, on the first pilot in the world. Argument: iterations (default 100000)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ABaseCharacter::BenchmarkMovementRules)
+);
+
+void ABaseCharacter::BenchmarkMovementRules(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+	TActorIterator<ABaseCharacter> It(World);
+	if (!It)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("pilot.BenchmarkMovementRules needs a spawned pilot"));
+		return;
+	}
+	ABaseCharacter* Pilot = *It;
+
+	// The handlers write input state, put it back afterwards so the pilot plays on unchanged.
+	const bool bSavedInputForward = Pilot->bInputForward;
+	const bool bSavedIsAccelForward = Pilot->bIsAccelForward;
+	const bool bSavedIsSprinting = Pilot->bIsSprinting;
+	const bool bSavedMeasureInputLatency = Pilot->bMeasureInputLatency;
+	const bool bSavedApplyDiscreteInputImmediately = Pilot->bApplyDiscreteInputImmediately;
+	Pilot->bMeasureInputLatency = false;
+	Pilot->bApplyDiscreteInputImmediately = false;
+
+	const UEnum* ArchetypeEnum = StaticEnum<EPilotArchetype>();
+	for (int32 ArchetypeIndex = 0; ArchetypeIndex < static_cast<int32>(EPilotArchetype::DefaultMax); ++ArchetypeIndex)
+	{
+		const FPilotMovementRules& Rules = FindMovementRules(static_cast<EPilotArchetype>(ArchetypeIndex));
+
+		// Per input event: a forward press, the jump check and the auto sprint check after crouch
+		volatile bool bCanJump = false;
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			(Pilot->*Rules.MoveForward)();
+			bCanJump = (Pilot->*Rules.CustomCanJump)();
+			(Pilot->*Rules.ResumeAutoSprint)();
+		}
+		const double InputEventNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.0e6 / Iterations;
+
+		UE_LOG(LogTemp, Log, TEXT("Movement rules %s: input event %.1fns (%d iterations)"),
+			*ArchetypeEnum->GetNameStringByIndex(ArchetypeIndex),
+			InputEventNs,
+			Iterations
+		);
+	}
+
+	// Per tick: the input work Tick does. None of it goes through MovementRules, so it is timed once
+	// and is the same for every archetype. The MoveForwardAxis rule isn't bound to any input.
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 i = 0; i < Iterations; ++i)
+	{
+		Pilot->ConsumeMovementInputVector();
+		Pilot->MovementInputManagement();
+		Pilot->GetCharacterMovement()->MaxWalkSpeed = Pilot->GetCurrentMaxSpeed();
+	}
+	const double PerTickNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.0e6 / Iterations;
+	Pilot->ConsumeMovementInputVector();
+
+	UE_LOG(LogTemp, Log, TEXT("Movement rules tick input path %.1fns for every archetype (%d iterations)"),
+		PerTickNs,
+		Iterations
+	);
+
+	Pilot->bInputForward = bSavedInputForward;
+	Pilot->bIsAccelForward = bSavedIsAccelForward;
+	Pilot->bIsSprinting = bSavedIsSprinting;
+	Pilot->bMeasureInputLatency = bSavedMeasureInputLatency;
+	Pilot->bApplyDiscreteInputImmediately = bSavedApplyDiscreteInputImmediately;
 }
 
 void ABaseCharacter::ActivateSlideBoost()
@@ -393,7 +967,7 @@ void ABaseCharacter::TiltCamera(float DeltaTime)
 	}
 
 	float TiltValue;
-	if (bIsSliding && SlideDirection.Length() > 0.f)
+	if (IsSliding() && SlideDirection.Length() > 0.f)
 	{
 		FVector LookRightVector = GetActorRightVector();
 		LookRightVector.Normalize();
@@ -426,7 +1000,7 @@ void ABaseCharacter::TiltCamera(float DeltaTime)
 void ABaseCharacter::ChangeFOV(float DeltaTime)
 {
 	float FOVValue;
-	if (bIsSliding)
+	if (IsSliding())
 	{
 		FOVValue = FMath::FInterpTo(
 			CameraComponent->FieldOfView,
@@ -449,9 +1023,10 @@ void ABaseCharacter::ChangeFOV(float DeltaTime)
 
 void ABaseCharacter::ShakeCamera()
 {
-	if (JumpLandCameraShake)
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (JumpLandCameraShake && PlayerController && PlayerController->PlayerCameraManager)
 	{
-		GetWorld()->GetFirstPlayerController()->PlayerCameraManager->PlayWorldCameraShake(
+		PlayerController->PlayerCameraManager->PlayWorldCameraShake(
 			GetWorld(),
 			JumpLandCameraShake,
 			GetActorLocation(),
@@ -504,7 +1079,7 @@ void ABaseCharacter::MovementInputManagement()
 void ABaseCharacter::ChangeGroundFriction()
 {
 	if (GetWorldTimerManager().IsTimerActive(GroundFrictionTimer) && 
-		!bIsSliding &&
+		!IsSliding() &&
 		GroundFrictionCurveFloat)
 	{
 		const float TimeElapsed = GetWorldTimerManager().GetTimerElapsed(GroundFrictionTimer);
@@ -515,28 +1090,103 @@ void ABaseCharacter::ChangeGroundFriction()
 
 void ABaseCharacter::RestoreGroundFriction()
 {
-	if (!bIsSliding)
+	if (!IsSliding())
 	{
 		GetCharacterMovement()->GroundFriction = DefaultGroundFriction;
 	}
 }
 
+DECLARE_CYCLE_STAT(TEXT("Record Telemetry"), STAT_PilotRecordTelemetry, STATGROUP_PilotMovement);
+
+void ABaseCharacter::RecordTelemetry()
+{
+	if (!bRecordTelemetry)
+	{
+		return;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_PilotRecordTelemetry);
+
+	FPilotMovementSample Sample;
+	Sample.TimeSeconds = GetWorld()->GetTimeSeconds();
+	Sample.VelocityXYKPH = GetVelocityXYKPH();
+	Sample.GroundFrictionMultiplier = DefaultGroundFriction > 0.f ? GetCharacterMovement()->GroundFriction / DefaultGroundFriction : 0.f;
+	Sample.MovementStatus = static_cast<uint8>(MovementStatus);
+	Sample.Events = PendingTelemetryEvents;
+	Telemetry.Record(Sample);
+
+	PendingTelemetryEvents = EPilotTelemetryEvent::None;
+}
+
+void ABaseCharacter::MeasureInputLatency(float DeltaSeconds, FVector OldLocation, FVector OldVelocity)
+{
+	InputLatency.ObserveMovement(
+		OldVelocity,
+		GetCharacterMovement()->Velocity,
+		GetActorForwardVector(),
+		VisualCapsuleHalfHeight
+	);
+}
+
+void ABaseCharacter::ApplyDiscreteInput()
+{
+	// Same work Tick does with the input booleans, done right away so this frame's movement update sees it.
+	// Jump needs nothing here, CustomJump already launches from the input handler.
+	if (CapsuleStepFrame == GFrameCounter)
+	{
+		// Tick or another handler already added this frame's movement input, replace it instead of adding to it.
+		ConsumeMovementInputVector();
+	}
+	MovementInputManagement();
+	GetCharacterMovement()->MaxWalkSpeed = GetCurrentMaxSpeed();
+	StepCapsuleOncePerFrame(GetWorld()->GetDeltaSeconds());
+}
+
+void ABaseCharacter::StepCapsuleOncePerFrame(float DeltaTime)
+{
+	if (CapsuleStepFrame != GFrameCounter)
+	{
+		CapsuleStepFrame = GFrameCounter;
+		InterpCapsuleHalfHeight(DeltaTime);
+	}
+}
+
+DECLARE_CYCLE_STAT(TEXT("Pilot Tick"), STAT_PilotTick, STATGROUP_PilotMovement);
+
 // Called every frame
 void ABaseCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_PilotTick);
 
+	// Input is always rebuilt from the booleans, replacing whatever a handler added earlier this frame,
+	// only the capsule step is skipped if a handler already did it.
+	ConsumeMovementInputVector();
 	MovementInputManagement();
 	GetCharacterMovement()->MaxWalkSpeed = GetCurrentMaxSpeed();
-	InterpCapsuleHalfHeight(DeltaTime);
-	TiltCamera(DeltaTime);
-	ChangeFOV(DeltaTime);
-	if (bIsSliding && GetVelocityKPH() <= 10.f)
+	StepCapsuleOncePerFrame(DeltaTime);
+	if (IsSliding() && GetVelocityKPH() <= SlideStopSpeedKPH)
+	{
+		SetMovementStatus(EMovementStatus::MS_Land);
+	}
+	RecordTelemetry();
+
+	// The local player's own camera is never budgeted, only other pilots' cosmetics degrade.
+	if (!WorkScheduler || IsLocalPlayerPilot())
 	{
-		StopSlide();
+		TickDeferredWork(DeltaTime);
 	}
+}
+
+void ABaseCharacter::TickDeferredWork(float DeltaTime)
+{
+	TiltCamera(DeltaTime);
+	ChangeFOV(DeltaTime);
 	ChangeGroundFriction();
+	DrawDebugTrace();
+}
 
+void ABaseCharacter::DrawDebugTrace()
+{
 	FHitResult HitResult;
 	TArray<AActor*> ar;
 	ECollisionChannel CC = ECollisionChannel::ECC_Visibility;
@@ -568,7 +1218,8 @@ void ABaseCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompo
 	// PlayerInputComponent->BindAxis(FName("Move Right / Left"), this, &ABaseCharacter::MoveRightAxis);
 	PlayerInputComponent->BindAxis(FName("Look Up / Down Mouse"), this, &ACharacter::AddControllerPitchInput);
 	PlayerInputComponent->BindAxis(FName("Turn Right / Left Mouse"), this, &ACharacter::AddControllerYawInput);
-	PlayerInputComponent->BindAction(FName("MoveForward"), EInputEvent::IE_Pressed, this, &ABaseCharacter::MoveForward);
+	// Archetype specialization from MovementRules, bound directly to skip the dispatching wrapper
+	PlayerInputComponent->BindAction(FName("MoveForward"), EInputEvent::IE_Pressed, this, MovementRules->MoveForward);
 	PlayerInputComponent->BindAction(FName("MoveForward"), EInputEvent::IE_Released, this, &ABaseCharacter::MoveForwardStop);
 	PlayerInputComponent->BindAction(FName("MoveBackward"), EInputEvent::IE_Pressed, this, &ABaseCharacter::MoveBackward);
 	PlayerInputComponent->BindAction(FName("MoveBackward"), EInputEvent::IE_Released, this, &ABaseCharacter::MoveBackwardStop);
@@ -588,8 +1239,6 @@ void ABaseCharacter::Landed(const FHitResult& Hit)
 {
 	Super::Landed(Hit);
 
-	bCanDoubleJump = true;
-	bIsJumping = false;
 	SetMovementStatus(EMovementStatus::MS_Land);
 	GetWorldTimerManager().SetTimer(
 		MaxJumpTimer,
@@ -606,12 +1255,9 @@ void ABaseCharacter::Landed(const FHitResult& Hit)
 
 	if (CanSlide())
 	{
-		StartSlide();
-	}
-	if (bAutoSprint && bInputForward)
-	{
-		bIsSprinting = true;
+		SetMovementStatus(EMovementStatus::MS_Slide);
 	}
+	ResumeAutoSprint();
 
 	ShakeCamera();
 }
@@ -626,6 +1272,22 @@ void ABaseCharacter::Falling()
 	}
 }
 
+DECLARE_CYCLE_STAT(TEXT("Jump Apex"), STAT_PilotJumpApex, STATGROUP_PilotMovement);
+
+void ABaseCharacter::NotifyJumpApex()
+{
+	// Called from UCharacterMovementComponent::PhysFalling when Velocity.Z turns negative.
+	// The status changes natively before Super broadcasts OnReachedJumpApex, which Blueprints still use for jump timing.
+	SCOPE_CYCLE_COUNTER(STAT_PilotJumpApex);
+
+	if (MovementStatus == EMovementStatus::MS_JumpBeforeApex)
+	{
+		SetMovementStatus(EMovementStatus::MS_Fall);
+	}
+
+	Super::NotifyJumpApex();
+}
+
 void ABaseCharacter::GetCameraLookDirection(FVector& OutWorldPosition, FVector& OutWorldDirection)
 {
 	// Get viewport size
@@ -648,6 +1310,113 @@ void ABaseCharacter::GetCameraLookDirection(FVector& OutWorldPosition, FVector&
 	);
 }
 
+bool ABaseCharacter::CheckMovementInvariants(FString& OutFailure) const
+{
+	const UCharacterMovementComponent* MovementComponent = GetCharacterMovement();
+
+	if (GetVelocity().ContainsNaN() || GetActorLocation().ContainsNaN())
+	{
+		OutFailure = FString::Printf(TEXT("Non-finite velocity %s or location %s"), *GetVelocity().ToString(), *GetActorLocation().ToString());
+		return false;
+	}
+
+	const float HalfHeight = GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	if (HalfHeight < CrouchCapsuleHalfHeight - KINDA_SMALL_NUMBER || HalfHeight > DefaultCapsuleHalfHeight + KINDA_SMALL_NUMBER)
+	{
+		OutFailure = FString::Printf(TEXT("Capsule half height %.2f outside [%.2f, %.2f]"), HalfHeight, CrouchCapsuleHalfHeight, DefaultCapsuleHalfHeight);
+		return false;
+	}
+
+	if (MovementStatus >= EMovementStatus::DefaultMax)
+	{
+		OutFailure = FString::Printf(TEXT("Invalid movement status %d"), static_cast<int32>(MovementStatus));
+		return false;
+	}
+
+	if (bIsWallrunning != IsWallrunning() || bIsSliding != IsSliding())
+	{
+		OutFailure = FString::Printf(TEXT("Blueprint status flags out of sync with movement status %d"), static_cast<int32>(MovementStatus));
+		return false;
+	}
+
+	if (!bIsCrouching && !bCanStandUp && (bIsSprinting || GetCurrentMaxSpeed() != CrouchSpeed))
+	{
+		OutFailure = FString::Printf(TEXT("Sprinting or above crouch speed with the capsule at %.2f waiting to stand up"), HalfHeight);
+		return false;
+	}
+
+	if (IsSliding())
+	{
+		if (MovementComponent->IsFalling())
+		{
+			OutFailure = TEXT("Sliding while falling");
+			return false;
+		}
+	}
+	else
+	{
+		if (!FMath::IsNearlyEqual(MovementComponent->MaxAcceleration, DefaultMaxAcceleration) ||
+			!FMath::IsNearlyEqual(MovementComponent->BrakingDecelerationWalking, DefaultBrakingDeceleration))
+		{
+			OutFailure = FString::Printf(
+				TEXT("Slide acceleration %.2f or braking %.2f not restored"),
+				MovementComponent->MaxAcceleration,
+				MovementComponent->BrakingDecelerationWalking
+			);
+			return false;
+		}
+		if (!GetWorldTimerManager().IsTimerActive(GroundFrictionTimer) &&
+			!FMath::IsNearlyEqual(MovementComponent->GroundFriction, DefaultGroundFriction))
+		{
+			OutFailure = FString::Printf(TEXT("Ground friction %.2f not restored"), MovementComponent->GroundFriction);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FPilotTrajectoryParams ABaseCharacter::GetTrajectoryParams() const
+{
+	const UCharacterMovementComponent* MovementComponent = GetCharacterMovement();
+
+	FPilotTrajectoryParams Params;
+	Params.GravityZ = MovementComponent->GetGravityZ();
+	Params.JumpZVelocity = MovementComponent->JumpZVelocity;
+	Params.InstantJumpMultiplier = InstantJumpMultiplier;
+	Params.SlideStartSpeed = SlideStartSpeedKPH * CPSPerKPH;
+	Params.SlideStopSpeed = SlideStopSpeedKPH * CPSPerKPH;
+	Params.SlideBoostForce = SlideBoostForce;
+	Params.SlideGroundFriction = SlideGroundFriction;
+	Params.SlideBrakingDeceleration = SlideBrakingDeceleration;
+	Params.GroundFriction = DefaultGroundFriction;
+	Params.BrakingDeceleration = DefaultBrakingDeceleration;
+	Params.BrakingFrictionFactor = MovementComponent->BrakingFrictionFactor;
+	return Params;
+}
+
+FPilotTrajectoryState ABaseCharacter::GetTrajectoryState() const
+{
+	FPilotTrajectoryState State;
+	State.Location = GetActorLocation();
+	State.Velocity = GetCharacterMovement()->GetLastUpdateVelocity();
+	State.bIsFalling = MovementStatus == EMovementStatus::MS_Fall || MovementStatus == EMovementStatus::MS_JumpBeforeApex;
+	// Nothing is known about the floor below a falling pilot, KillZ keeps the predicted arc finite.
+	State.FloorZ = State.bIsFalling ? GetWorldSettings()->KillZ : State.Location.Z;
+	State.bIsSliding = IsSliding();
+	State.bCanMaxJump = bCanMaxJump;
+	(this->*MovementRules->GetTrajectoryRules)(State);
+	return State;
+}
+
+template <typename Policy>
+void ABaseCharacter::GetTrajectoryRulesImpl(FPilotTrajectoryState& State) const
+{
+	// Same conditions CustomCanJumpImpl and StartSlideImpl apply
+	State.bCanDoubleJump = Policy::DoubleJump(bEnableDoubleJump) && bCanDoubleJump;
+	State.bCanSlideBoost = Policy::SlideBoost(bEnableSlideBoost) && bCanSlideBoost;
+}
+
 float ABaseCharacter::GetVelocityCPS() const
 {
 	return GetCharacterMovement()->GetLastUpdateVelocity().Length();
@@ -670,4 +1439,9 @@ float ABaseCharacter::GetVelocityXYCPS() const
 float ABaseCharacter::GetVelocityXYKPH() const
 {
 	return GetVelocityXYCPS() / 1000.f * 36.f;
-}
\ No newline at end of file
+}
+
+void ABaseCharacter::ExportMovementTelemetry()
+{
+	Telemetry.Flush();
+}
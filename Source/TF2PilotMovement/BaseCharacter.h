@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "PilotInputLatency.h"
+#include "PilotMovementTelemetry.h"
+#include "PilotTrajectoryPredictor.h"
 #include "BaseCharacter.generated.h"
 
 class UCameraComponent;
 class UCameraShake;
+class UPilotWorkScheduler;
 class USceneComponent;
 class USpringArmComponent;
 
@@ -18,6 +22,20 @@ enum class EMovementStatus : uint8
 	MS_Wallrun			UMETA(DisplayName = "Wallrun"),
 	MS_Fall				UMETA(DisplayName = "Fall"),
 	MS_JumpBeforeApex	UMETA(DisplayName = "JumpBeforeApex"),
+	// Values are written to movement telemetry, add new statuses here only
+	MS_Slide			UMETA(DisplayName = "Slide"),
+
+	DefaultMax			UMETA(DisplayName = "DefaultMax")
+};
+
+// Compile-time movement rule sets, Custom follows the pilot's Setup flags at runtime.
+UENUM(BlueprintType)
+enum class EPilotArchetype : uint8
+{
+	PA_Custom			UMETA(DisplayName = "Custom"),
+	PA_Standard			UMETA(DisplayName = "Standard"),
+	PA_ToggleSprint		UMETA(DisplayName = "ToggleSprint"),
+	PA_Grounded			UMETA(DisplayName = "Grounded"),
 
 	DefaultMax			UMETA(DisplayName = "DefaultMax")
 };
@@ -27,16 +45,21 @@ class TF2PILOTMOVEMENT_API ABaseCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	friend class APilotSoakHarness;
+
 public:
 	// Sets default values for this character's properties
 	ABaseCharacter();
 
 	virtual void Landed(const FHitResult& Hit) override;
 	virtual void Falling() override;
+	virtual void NotifyJumpApex() override;
+	virtual void PostInitializeComponents() override;
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	void MoveForward();
 	void MoveForwardStop();
@@ -57,13 +80,31 @@ protected:
 	void CustomStartCrouch();
 	void CustomStopCrouch();
 	void SprintOrWalk();
+	void ResumeAutoSprint();
+
+	// Specializations of the input handlers above for a movement policy, see BaseCharacter.cpp
+	template <typename Policy> void MoveForwardImpl();
+	template <typename Policy> void MoveForwardAxisImpl(float Value);
+	template <typename Policy> bool CustomCanJumpImpl() const;
+	template <typename Policy> void StartSlideImpl();
+	template <typename Policy> void ResumeAutoSprintImpl();
+	template <typename Policy> void GetTrajectoryRulesImpl(FPilotTrajectoryState& State) const;
 
 	void SetMovementStatus(EMovementStatus NewStatus);
+	void EnterLand();
 
 	float GetCurrentMaxSpeed() const;
+	// Crouch held, or released while the capsule is still crouched waiting for room to stand up
+	bool IsCrouchedForMovement() const { return bIsCrouching || !bCanStandUp; }
 
 	void InterpCapsuleHalfHeight(float DeltaTime);
+	void CommitCapsuleHalfHeight(float HalfHeight);
+	bool CanStandUp() const;
+	void StandUp();
 
+	// NotifyJumpApex already moved the status to Fall, so this changes nothing. The Blueprint round trip is
+	// still paid on every jump though: Super::NotifyJumpApex broadcasts OnReachedJumpApex to BP_BaseCharacter,
+	// whose graph calls back into this. Remove it once that call is gone from the graph.
 	UFUNCTION(BlueprintCallable)
 	void ReachedJumpApex();
 
@@ -77,11 +118,24 @@ protected:
 	void ShakeCamera();
 
 	void MovementInputManagement();
+	void DrawDebugTrace();
 
 	void ChangeGroundFriction();
 	void RestoreGroundFriction();
 
+	void RecordTelemetry();
+
+	UFUNCTION()
+	void MeasureInputLatency(float DeltaSeconds, FVector OldLocation, FVector OldVelocity);
+	void ApplyDiscreteInput();
+	void StepCapsuleOncePerFrame(float DeltaTime);
+
 private:
+	// Slides start above and stop at or below these speeds. Shared with the trajectory predictor.
+	static constexpr float SlideStartSpeedKPH = 20.f;
+	static constexpr float SlideStopSpeedKPH = 10.f;
+	static constexpr float CPSPerKPH = 1000.f / 36.f;
+
 	// Components
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Components", meta = (AllowPrivateAccess))
 	USpringArmComponent* CameraPitchControlBase;
@@ -99,7 +153,13 @@ private:
 
 	// Setups
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup", meta = (AllowPrivateAccess = "true"))
+	EPilotArchetype Archetype;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup", meta = (AllowPrivateAccess = "true", EditCondition = "Archetype == EPilotArchetype::PA_Custom"))
 	bool bAutoSprint;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup", meta = (AllowPrivateAccess = "true", EditCondition = "Archetype == EPilotArchetype::PA_Custom"))
+	bool bEnableSlideBoost;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup", meta = (AllowPrivateAccess = "true", EditCondition = "Archetype == EPilotArchetype::PA_Custom"))
+	bool bEnableDoubleJump;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup", meta = (AllowPrivateAccess = "true"))
 	UCurveFloat* GroundFrictionCurveFloat;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Setup|Camera", meta = (AllowPrivateAccess = "true"))
@@ -123,6 +183,17 @@ private:
 	float CapsuleInterpSpeed;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Crouch", meta = (AllowPrivateAccess = "true"))
 	float CrouchCapsuleHalfHeight;
+	// Smallest visual height change that is pushed to the collision capsule
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Crouch", meta = (AllowPrivateAccess = "true"))
+	float CapsuleCommitThreshold;
+	// Minimum time between collision capsule updates while the height is interpolating
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Crouch", meta = (AllowPrivateAccess = "true"))
+	float CapsuleCommitInterval;
+	float VisualCapsuleHalfHeight;
+	float CapsuleCommitTimer;
+	// False from crouch until the room check after release passes
+	bool bCanStandUp;
+	float StandUpRetryTimer;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Slide", meta = (AllowPrivateAccess = "true"))
 	float SlideBoostResetTime;
@@ -142,6 +213,16 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Jump", meta = (AllowPrivateAccess = "true"))
 	float InstantJumpMultiplier;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Telemetry", meta = (AllowPrivateAccess = "true"))
+	bool bRecordTelemetry;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Telemetry", meta = (AllowPrivateAccess = "true"))
+	int32 TelemetryCapacity;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Telemetry", meta = (AllowPrivateAccess = "true"))
+	bool bMeasureInputLatency;
+	// Push forward, jump and crouch input to the movement component from the input handler instead of the next Tick
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Setup|Telemetry", meta = (AllowPrivateAccess = "true"))
+	bool bApplyDiscreteInputImmediately;
+
 	// Status
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Input", meta = (AllowPrivateAccess = "true"))
 	bool bInputForward;
@@ -159,39 +240,76 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
 	bool bWalkSprintInput;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
-	bool bIsWallrunning;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
 	bool bIsCrouching;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
-	bool bIsSliding;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
 	bool bCanSlideBoost;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
-	bool bIsJumping;
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
 	bool bCanMaxJump;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
 	bool bCanDoubleJump;
-
+	// Mirrors of MovementStatus for Blueprints that read them (WBP_Crosshair reads bIsWallrunning),
+	// only written by SetMovementStatus
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
+	bool bIsWallrunning;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
+	bool bIsSliding;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Status", meta = (AllowPrivateAccess = "true"))
+	bool bIsJumping;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
 	EMovementStatus MovementStatus;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 InvalidMovementStatusTransitions;
+
+	// Input handlers specialized for the pilot's archetype, picked in PostInitializeComponents
+	struct FPilotMovementRules
+	{
+		void (ABaseCharacter::*MoveForward)();
+		void (ABaseCharacter::*MoveForwardAxis)(float);
+		bool (ABaseCharacter::*CustomCanJump)() const;
+		void (ABaseCharacter::*StartSlide)();
+		void (ABaseCharacter::*ResumeAutoSprint)();
+		void (ABaseCharacter::*GetTrajectoryRules)(FPilotTrajectoryState&) const;
+	};
+	template <typename Policy> static FPilotMovementRules MakeMovementRules();
+	static const FPilotMovementRules& FindMovementRules(EPilotArchetype InArchetype);
+	const FPilotMovementRules* MovementRules;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Movement|Slide", meta = (AllowPrivateAccess = "true"))
 	FVector SlideDirection;
 
 	float DefaultMaxAcceleration;
 
+	UPROPERTY(Transient)
+	UPilotWorkScheduler* WorkScheduler;
+
+	// Telemetry
+	FPilotMovementTelemetry Telemetry;
+	EPilotTelemetryEvent PendingTelemetryEvents;
+	FPilotInputLatencyTracker InputLatency;
+	// GFrameCounter of the last capsule step, so a handler and Tick in the same frame step it once whatever their order
+	uint64 CapsuleStepFrame;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Cosmetic and debug part of Tick, run by UPilotWorkScheduler within its frame budget unless this is the local player
+	void TickDeferredWork(float DeltaTime);
+	// IsLocallyControlled alone is also true for AI on a server and for every pilot in Standalone
+	bool IsLocalPlayerPilot() const { return IsPlayerControlled() && IsLocallyControlled(); }
+
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	UFUNCTION(BlueprintCallable)
 	void GetCameraLookDirection(FVector& OutWorldPosition, FVector& OutWorldDirection);
 
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsSliding() const { return MovementStatus == EMovementStatus::MS_Slide; }
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsWallrunning() const { return MovementStatus == EMovementStatus::MS_Wallrun; }
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	float GetVelocityCPS() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure)
@@ -200,4 +318,19 @@ public:
 	float GetVelocityXYCPS() const;
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	float GetVelocityXYKPH() const;
+
+	// Returns false and describes the first broken invariant if the movement state is inconsistent.
+	bool CheckMovementInvariants(FString& OutFailure) const;
+
+	const FPilotInputLatencyTracker& GetInputLatency() const { return InputLatency; }
+
+	FPilotTrajectoryParams GetTrajectoryParams() const;
+	FPilotTrajectoryState GetTrajectoryState() const;
+
+	// pilot.BenchmarkMovementRules: times the input handlers of every archetype, and the tick input path, on a pilot in World
+	static void BenchmarkMovementRules(const TArray<FString>& Args, UWorld* World);
+
+	// Appends the samples recorded since the last automatic flush to the pilot's file in Saved/Telemetry.
+	UFUNCTION(BlueprintCallable)
+	void ExportMovementTelemetry();
 };
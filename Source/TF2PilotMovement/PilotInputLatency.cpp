@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotInputLatency.h"
+#include "HAL/PlatformTime.h"
+
+namespace
+{
+	const TCHAR* GetLatencyActionName(EPilotLatencyAction Action)
+	{
+		switch (Action)
+		{
+		case EPilotLatencyAction::MoveForward:
+			return TEXT("MoveForward");
+		case EPilotLatencyAction::Jump:
+			return TEXT("Jump");
+		case EPilotLatencyAction::Crouch:
+			return TEXT("Crouch");
+		default:
+			return TEXT("Unknown");
+		}
+	}
+}
+
+void FPilotLatencyHistogram::Add(double LatencyMs)
+{
+	const int32 Bucket = FMath::Clamp(FMath::FloorToInt(LatencyMs / BucketWidthMs), 0, NumBuckets - 1);
+	++Buckets[Bucket];
+	++Count;
+	SumMs += LatencyMs;
+	MaxMs = FMath::Max(MaxMs, LatencyMs);
+}
+
+FString FPilotLatencyHistogram::ToString() const
+{
+	FString Result = FString::Printf(
+		TEXT("n=%u discarded=%u avg=%.2fms max=%.2fms |"),
+		Count,
+		Discarded,
+		Count > 0 ? SumMs / Count : 0.0,
+		MaxMs
+	);
+	for (int32 i = 0; i < NumBuckets; ++i)
+	{
+		Result += FString::Printf(TEXT(" %u"), Buckets[i]);
+	}
+	return Result;
+}
+
+void FPilotInputLatencyTracker::MarkInput(EPilotLatencyAction Action, float CapsuleHalfHeight)
+{
+	FPendingInput& Pending = PendingInputs[static_cast<int32>(Action)];
+	Pending.Cycles = FPlatformTime::Cycles64();
+	Pending.CapsuleHalfHeight = CapsuleHalfHeight;
+	Pending.bPending = true;
+}
+
+void FPilotInputLatencyTracker::CancelInput(EPilotLatencyAction Action)
+{
+	FPendingInput& Pending = PendingInputs[static_cast<int32>(Action)];
+	if (Pending.bPending)
+	{
+		++Histograms[static_cast<int32>(Action)].Discarded;
+		Pending.bPending = false;
+	}
+}
+
+void FPilotInputLatencyTracker::DiscardStale(uint64 NowCycles)
+{
+	for (int32 i = 0; i < static_cast<int32>(EPilotLatencyAction::Num); ++i)
+	{
+		if (PendingInputs[i].bPending && FPlatformTime::ToMilliseconds64(NowCycles - PendingInputs[i].Cycles) > MaxPendingMs)
+		{
+			CancelInput(static_cast<EPilotLatencyAction>(i));
+		}
+	}
+}
+
+void FPilotInputLatencyTracker::ObserveMovement(const FVector& OldVelocity, const FVector& NewVelocity, const FVector& Forward, float CapsuleHalfHeight)
+{
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	const FVector DeltaVelocity = NewVelocity - OldVelocity;
+
+	DiscardStale(NowCycles);
+
+	if (PendingInputs[static_cast<int32>(EPilotLatencyAction::MoveForward)].bPending &&
+		FVector::DotProduct(DeltaVelocity, Forward) > 1.f)
+	{
+		Resolve(EPilotLatencyAction::MoveForward, NowCycles);
+	}
+	if (PendingInputs[static_cast<int32>(EPilotLatencyAction::Jump)].bPending &&
+		DeltaVelocity.Z > 1.f)
+	{
+		Resolve(EPilotLatencyAction::Jump, NowCycles);
+	}
+	const FPendingInput& Crouch = PendingInputs[static_cast<int32>(EPilotLatencyAction::Crouch)];
+	if (Crouch.bPending && CapsuleHalfHeight < Crouch.CapsuleHalfHeight - KINDA_SMALL_NUMBER)
+	{
+		Resolve(EPilotLatencyAction::Crouch, NowCycles);
+	}
+}
+
+void FPilotInputLatencyTracker::Resolve(EPilotLatencyAction Action, uint64 NowCycles)
+{
+	FPendingInput& Pending = PendingInputs[static_cast<int32>(Action)];
+	Histograms[static_cast<int32>(Action)].Add(FPlatformTime::ToMilliseconds64(NowCycles - Pending.Cycles));
+	Pending.bPending = false;
+}
+
+const FPilotLatencyHistogram& FPilotInputLatencyTracker::GetHistogram(EPilotLatencyAction Action) const
+{
+	return Histograms[static_cast<int32>(Action)];
+}
+
+void FPilotInputLatencyTracker::LogHistograms(const FString& OwnerName) const
+{
+	for (int32 i = 0; i < static_cast<int32>(EPilotLatencyAction::Num); ++i)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s input latency %s (%.0fms buckets): %s"),
+			*OwnerName,
+			GetLatencyActionName(static_cast<EPilotLatencyAction>(i)),
+			FPilotLatencyHistogram::BucketWidthMs,
+			*Histograms[i].ToString()
+		);
+	}
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EPilotLatencyAction : uint8
+{
+	MoveForward,
+	Jump,
+	Crouch,
+
+	Num
+};
+
+// Fixed-width latency buckets in milliseconds, the last bucket collects everything above.
+struct FPilotLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 16;
+	static constexpr double BucketWidthMs = 4.0;
+
+	uint32 Buckets[NumBuckets] = {};
+	uint32 Count = 0;
+	// Inputs that never showed up in movement, cancelled on release or timed out
+	uint32 Discarded = 0;
+	double SumMs = 0.0;
+	double MaxMs = 0.0;
+
+	void Add(double LatencyMs);
+	FString ToString() const;
+};
+
+/**
+ * Measures the time from an input event being ingested to the movement component first applying it.
+ * MarkInput is called from the input handlers, ObserveMovement at the end of each movement update.
+ * Inputs still pending after MaxPendingMs, or released before they moved the pilot, are discarded.
+ */
+class TF2PILOTMOVEMENT_API FPilotInputLatencyTracker
+{
+public:
+	static constexpr double MaxPendingMs = 500.0;
+
+	void MarkInput(EPilotLatencyAction Action, float CapsuleHalfHeight);
+	void CancelInput(EPilotLatencyAction Action);
+	void ObserveMovement(const FVector& OldVelocity, const FVector& NewVelocity, const FVector& Forward, float CapsuleHalfHeight);
+
+	const FPilotLatencyHistogram& GetHistogram(EPilotLatencyAction Action) const;
+	void LogHistograms(const FString& OwnerName) const;
+
+private:
+	void Resolve(EPilotLatencyAction Action, uint64 NowCycles);
+	void DiscardStale(uint64 NowCycles);
+
+	struct FPendingInput
+	{
+		uint64 Cycles = 0;
+		float CapsuleHalfHeight = 0.f;
+		bool bPending = false;
+	};
+
+	FPendingInput PendingInputs[static_cast<int32>(EPilotLatencyAction::Num)];
+	FPilotLatencyHistogram Histograms[static_cast<int32>(EPilotLatencyAction::Num)];
+};
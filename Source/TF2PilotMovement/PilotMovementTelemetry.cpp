@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotMovementTelemetry.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Compression.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "TF2PilotMovement.h"
+
+DECLARE_CYCLE_STAT(TEXT("Telemetry Flush"), STAT_PilotTelemetryFlush, STATGROUP_PilotMovement);
+
+void FPilotMovementTelemetry::Start(int32 InCapacity, const FString& InFilePath)
+{
+	const uint32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 1));
+	Samples.SetNumZeroed(Capacity);
+	Mask = Capacity - 1;
+	Head = 0;
+	FlushedHead = 0;
+	FilePath = InFilePath;
+	FileLock = MakeShared<FCriticalSection, ESPMode::ThreadSafe>();
+}
+
+bool FPilotMovementTelemetry::Flush()
+{
+	const uint32 NumSamples = Head - FlushedHead;
+	if (NumSamples == 0)
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_PilotTelemetryFlush);
+
+	// Copy the block in chronological order, the rest happens off the game thread.
+	// Flushing at half capacity means the block is never overwritten before this copy.
+	TArray<FPilotMovementSample> Snapshot;
+	Snapshot.Reserve(NumSamples);
+	for (uint32 Index = FlushedHead; Index != Head; ++Index)
+	{
+		Snapshot.Add(Samples[Index & Mask]);
+	}
+	const uint32 FirstSample = FlushedHead;
+	FlushedHead = Head;
+
+	Async(EAsyncExecution::ThreadPool, [Snapshot = MoveTemp(Snapshot), FirstSample, FilePath = FilePath, FileLock = FileLock]()
+	{
+		const int32 N = Snapshot.Num();
+		TArray<uint8> Columns;
+		Columns.SetNumUninitialized(N * (3 * sizeof(float) + 2 * sizeof(uint8)));
+
+		float* TimeColumn = reinterpret_cast<float*>(Columns.GetData());
+		float* VelocityColumn = TimeColumn + N;
+		float* FrictionColumn = VelocityColumn + N;
+		uint8* StatusColumn = reinterpret_cast<uint8*>(FrictionColumn + N);
+		uint8* EventColumn = StatusColumn + N;
+		for (int32 i = 0; i < N; ++i)
+		{
+			const FPilotMovementSample& Sample = Snapshot[i];
+			TimeColumn[i] = Sample.TimeSeconds;
+			VelocityColumn[i] = Sample.VelocityXYKPH;
+			FrictionColumn[i] = Sample.GroundFrictionMultiplier;
+			StatusColumn[i] = Sample.MovementStatus;
+			EventColumn[i] = static_cast<uint8>(Sample.Events);
+		}
+
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Columns.Num());
+		TArray<uint8> Compressed;
+		Compressed.SetNumUninitialized(CompressedSize);
+		if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Columns.GetData(), Columns.Num()))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to compress %d movement telemetry samples for %s"), N, *FilePath);
+			return;
+		}
+
+		const uint32 BlockHeader[] = {
+			FirstSample,
+			static_cast<uint32>(N),
+			static_cast<uint32>(Columns.Num()),
+			static_cast<uint32>(CompressedSize)
+		};
+
+		FScopeLock Lock(FileLock.Get());
+
+		TArray<uint8> Block;
+		if (IFileManager::Get().FileSize(*FilePath) <= 0)
+		{
+			const uint32 FileHeader[] = { FileMagic, FileVersion };
+			Block.Append(reinterpret_cast<const uint8*>(FileHeader), sizeof(FileHeader));
+		}
+		Block.Append(reinterpret_cast<const uint8*>(BlockHeader), sizeof(BlockHeader));
+		Block.Append(Compressed.GetData(), CompressedSize);
+
+		if (!FFileHelper::SaveArrayToFile(Block, *FilePath, &IFileManager::Get(), FILEWRITE_Append))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to append %d movement telemetry samples to %s"), N, *FilePath);
+		}
+	});
+
+	return true;
+}
+
+// Records a frame of samples for every pilot the way ABaseCharacter::Tick does, including the flushes
+// at half capacity, and reports the game thread cost per frame against a 60Hz frame.
+static void BenchmarkTelemetry(const TArray<FString>& Args)
+{
+	const int32 NumPilots = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 64;
+	const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 16384;
+	const int32 Capacity = Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 4096;
+	const double FrameBudgetUs = 1.0e6 / 60.0;
+
+	TArray<FPilotMovementTelemetry> Pilots;
+	Pilots.SetNum(NumPilots);
+	for (int32 Pilot = 0; Pilot < NumPilots; ++Pilot)
+	{
+		Pilots[Pilot].Start(Capacity, FPaths::Combine(
+			FPaths::ProjectSavedDir(),
+			TEXT("Telemetry"),
+			TEXT("Benchmark"),
+			FString::Printf(TEXT("Pilot_%d_%s.pmt"), Pilot, *FDateTime::Now().ToString())
+		));
+	}
+
+	double TotalUs = 0.0;
+	double WorstFrameUs = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		FPilotMovementSample Sample;
+		Sample.TimeSeconds = Frame / 60.f;
+		Sample.GroundFrictionMultiplier = 1.f;
+		Sample.Events = Frame % 97 == 0 ? EPilotTelemetryEvent::InstantJump : EPilotTelemetryEvent::None;
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (int32 Pilot = 0; Pilot < NumPilots; ++Pilot)
+		{
+			Sample.VelocityXYKPH = static_cast<float>((Frame + Pilot) % 50);
+			Sample.MovementStatus = static_cast<uint8>(((Frame + Pilot) / 64) % 5);
+			Pilots[Pilot].Record(Sample);
+		}
+		const double FrameUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+		TotalUs += FrameUs;
+		WorstFrameUs = FMath::Max(WorstFrameUs, FrameUs);
+	}
+
+	// The final flush EndPlay does
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (FPilotMovementTelemetry& Pilot : Pilots)
+	{
+		Pilot.Flush();
+	}
+	const double FinalFlushUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+
+	const double AverageUs = TotalUs / NumFrames;
+	UE_LOG(LogTemp, Log, TEXT("Telemetry benchmark: %d pilots, %d frames, capacity %d, record + flush %.2fus/frame avg (%.3f%% of 60Hz), worst frame %.2fus (%.3f%%), final flush %.2fus"),
+		NumPilots,
+		NumFrames,
+		Capacity,
+		AverageUs,
+		AverageUs / FrameBudgetUs * 100.0,
+		WorstFrameUs,
+		WorstFrameUs / FrameBudgetUs * 100.0,
+		FinalFlushUs
+	);
+}
+
+static FAutoConsoleCommand PilotBenchmarkTelemetryCommand(
+	TEXT("pilot.BenchmarkTelemetry"),
+	TEXT("Times movement telemetry recording and flushing on the game thread. Arguments: pilots (default 64), frames (default 16384), capacity (default 4096). Writes to Saved/Telemetry/Benchmark."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkTelemetry)
+);
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EPilotTelemetryEvent : uint8
+{
+	None			= 0,
+	SlideStart		= 1 << 0,
+	SlideStop		= 1 << 1,
+	InstantJump		= 1 << 2,
+	MaxJump			= 1 << 3,
+	DoubleJump		= 1 << 4,
+};
+ENUM_CLASS_FLAGS(EPilotTelemetryEvent);
+
+// One fixed-size sample per pilot per frame.
+struct FPilotMovementSample
+{
+	float TimeSeconds;
+	float VelocityXYKPH;
+	float GroundFrictionMultiplier;
+	uint8 MovementStatus;
+	EPilotTelemetryEvent Events;
+};
+
+/**
+ * Per-pilot ring buffer of movement samples.
+ * Written only from the game thread, so recording is a single store and an index increment.
+ * Whenever half the buffer has been recorded since the last flush, that block is copied and handed
+ * to the thread pool, which compresses it and appends it to the pilot's file:
+ *   File    : uint32 Magic ('PMTL'), uint32 Version, then any number of blocks
+ *   Block   : uint32 FirstSample, uint32 NumSamples, uint32 UncompressedSize, uint32 CompressedSize,
+ *             zlib compressed payload
+ *   Payload : float TimeSeconds[N], float VelocityXYKPH[N], float GroundFrictionMultiplier[N],
+ *             uint8 MovementStatus[N], uint8 Events[N]
+ * MovementStatus is EMovementStatus: 0 Land, 1 Wallrun, 2 Fall, 3 JumpBeforeApex, 4 Slide.
+ * Events are EPilotTelemetryEvent bits.
+ * Blocks may land out of order, FirstSample is the running sample index to sort them by.
+ * Tools/ConvertPilotTelemetry.py turns a file into CSV or Parquet.
+ * pilot.BenchmarkTelemetry reports the game thread cost of Record and Flush per frame for a crowd of pilots.
+ */
+class TF2PILOTMOVEMENT_API FPilotMovementTelemetry
+{
+public:
+	static constexpr uint32 FileMagic = 0x4C544D50; // "PMTL"
+	static constexpr uint32 FileVersion = 2;
+
+	// Capacity is rounded up to a power of two. Blocks are appended to FilePath.
+	void Start(int32 InCapacity, const FString& InFilePath);
+
+	FORCEINLINE void Record(const FPilotMovementSample& Sample)
+	{
+		if (Samples.Num() > 0)
+		{
+			Samples[Head & Mask] = Sample;
+			++Head;
+			if (Head - FlushedHead > Mask / 2)
+			{
+				Flush();
+			}
+		}
+	}
+
+	// Hands every sample recorded since the last flush to the background writer.
+	// Returns false if there is nothing to write.
+	bool Flush();
+
+private:
+	TArray<FPilotMovementSample> Samples;
+	uint32 Mask = 0;
+	uint32 Head = 0;
+	uint32 FlushedHead = 0;
+	FString FilePath;
+	// Shared with in-flight writes so blocks from one pilot never interleave in the file.
+	TSharedPtr<FCriticalSection, ESPMode::ThreadSafe> FileLock;
+};
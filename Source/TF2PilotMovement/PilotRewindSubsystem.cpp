@@ -0,0 +1,341 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotRewindSubsystem.h"
+#include "BaseCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "TF2PilotMovement.h"
+
+static TAutoConsoleVariable<int32> CVarPilotRewindMaxPilots(
+	TEXT("pilot.RewindMaxPilots"),
+	64,
+	TEXT("Number of pilot slots the lag compensation history starts with, doubled whenever more pilots register. Read when the world starts."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPilotRewindHistorySeconds(
+	TEXT("pilot.RewindHistorySeconds"),
+	.2f,
+	TEXT("How far back the lag compensation history reaches. Read when the world starts."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPilotRewindMaxTickRate(
+	TEXT("pilot.RewindMaxTickRate"),
+	120.f,
+	TEXT("Most frames per second recorded into the lag compensation history, faster ticks skip frames. Read when the world starts."),
+	ECVF_Default
+);
+
+DECLARE_CYCLE_STAT(TEXT("Rewind Record"), STAT_PilotRewindRecord, STATGROUP_PilotMovement);
+DECLARE_CYCLE_STAT(TEXT("Rewind Hit Test"), STAT_PilotRewindHitTest, STATGROUP_PilotMovement);
+
+namespace
+{
+	float GetRewindMaxTickRate()
+	{
+		return FMath::Max(CVarPilotRewindMaxTickRate.GetValueOnGameThread(), 1.f);
+	}
+
+	// Recording at most MaxTickRate frames per second, this many frames always span HistorySeconds.
+	int32 GetRewindHistoryFrames()
+	{
+		const float HistorySeconds = FMath::Max(CVarPilotRewindHistorySeconds.GetValueOnGameThread(), 0.f);
+		return FMath::CeilToInt(HistorySeconds * GetRewindMaxTickRate()) + 1;
+	}
+}
+
+void FPilotRewindHistory::Init(int32 InNumSlots, int32 InNumFrames)
+{
+	NumSlots = FMath::Max(InNumSlots, 1);
+	MaxFrames = FMath::Max(InNumFrames, 2);
+
+	Samples.SetNumZeroed(NumSlots * MaxFrames);
+	FrameTimes.SetNumZeroed(MaxFrames);
+	SlotRadii.SetNumZeroed(NumSlots);
+	NewestFrame = INDEX_NONE;
+	NumFrames = 0;
+}
+
+void FPilotRewindHistory::SetNumSlots(int32 InNumSlots)
+{
+	if (InNumSlots <= NumSlots)
+	{
+		return;
+	}
+
+	TArray<FPilotRewindSample> NewSamples;
+	NewSamples.SetNumZeroed(InNumSlots * MaxFrames);
+	for (int32 Frame = 0; Frame < MaxFrames; ++Frame)
+	{
+		FMemory::Memcpy(&NewSamples[Frame * InNumSlots], GetFrameRow(Frame), NumSlots * sizeof(FPilotRewindSample));
+	}
+	Samples = MoveTemp(NewSamples);
+	SlotRadii.SetNumZeroed(InNumSlots);
+	NumSlots = InNumSlots;
+}
+
+void FPilotRewindHistory::ClearSlot(int32 Slot)
+{
+	for (int32 Frame = 0; Frame < MaxFrames; ++Frame)
+	{
+		Samples[Frame * NumSlots + Slot].bValid = 0;
+	}
+}
+
+FPilotRewindSample* FPilotRewindHistory::AddFrame(double Timestamp)
+{
+	NewestFrame = (NewestFrame + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+	FrameTimes[NewestFrame] = Timestamp;
+	return &Samples[NewestFrame * NumSlots];
+}
+
+void FPilotRewindHistory::Quantize(FPilotRewindSample& Sample, const FVector& Location, float HalfHeight)
+{
+	const FVector Scaled = Location * QuantizeScale;
+	Sample.X = FMath::RoundToInt(Scaled.X);
+	Sample.Y = FMath::RoundToInt(Scaled.Y);
+	Sample.Z = FMath::RoundToInt(Scaled.Z);
+	Sample.HalfHeight = static_cast<uint16>(FMath::Clamp(
+		FMath::RoundToInt(HalfHeight * QuantizeScale),
+		0,
+		static_cast<int32>(MAX_uint16)
+	));
+	Sample.bValid = 1;
+}
+
+int32 FPilotRewindHistory::SegmentTest(double Timestamp, const FVector& Start, const FVector& End, FVector& OutHitLocation) const
+{
+	if (NumFrames == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	// Find the two recorded frames around Timestamp, clamped to the history we have.
+	int32 OlderFrame = NewestFrame;
+	int32 NewerFrame = NewestFrame;
+	for (int32 Age = 0; Age < NumFrames; ++Age)
+	{
+		const int32 Frame = (NewestFrame - Age + MaxFrames) % MaxFrames;
+		OlderFrame = Frame;
+		if (FrameTimes[Frame] <= Timestamp)
+		{
+			break;
+		}
+		NewerFrame = Frame;
+	}
+	const double FrameSpan = FrameTimes[NewerFrame] - FrameTimes[OlderFrame];
+	const float Alpha = FrameSpan > 0.0 ? static_cast<float>(FMath::Clamp((Timestamp - FrameTimes[OlderFrame]) / FrameSpan, 0.0, 1.0)) : 0.f;
+
+	const FPilotRewindSample* OlderRow = GetFrameRow(OlderFrame);
+	const FPilotRewindSample* NewerRow = GetFrameRow(NewerFrame);
+	const float InvScale = 1.f / QuantizeScale;
+	float ClosestDistanceSquared = TNumericLimits<float>::Max();
+	int32 HitSlot = INDEX_NONE;
+	for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+	{
+		const FPilotRewindSample& Older = OlderRow[Slot];
+		const FPilotRewindSample& Newer = NewerRow[Slot];
+		if (!Older.bValid || !Newer.bValid)
+		{
+			continue;
+		}
+
+		const FVector Center = FMath::Lerp(
+			FVector(Older.X, Older.Y, Older.Z),
+			FVector(Newer.X, Newer.Y, Newer.Z),
+			Alpha
+		) * InvScale;
+		const float HalfHeight = FMath::Lerp<float>(Older.HalfHeight, Newer.HalfHeight, Alpha) * InvScale;
+		const float Radius = SlotRadii[Slot];
+		const FVector Axis(0.f, 0.f, FMath::Max(HalfHeight - Radius, 0.f));
+
+		FVector OnSegment, OnCapsule;
+		FMath::SegmentDistToSegmentSafe(Start, End, Center - Axis, Center + Axis, OnSegment, OnCapsule);
+		if (FVector::DistSquared(OnSegment, OnCapsule) > Radius * Radius)
+		{
+			continue;
+		}
+
+		const float DistanceSquared = FVector::DistSquared(Start, OnSegment);
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			HitSlot = Slot;
+			OutHitLocation = OnSegment;
+		}
+	}
+
+	return HitSlot;
+}
+
+void UPilotRewindSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	History.Init(CVarPilotRewindMaxPilots.GetValueOnGameThread(), GetRewindHistoryFrames());
+	RecordInterval = 1.0 / GetRewindMaxTickRate();
+	Slots.SetNum(History.GetNumSlots());
+}
+
+void UPilotRewindSubsystem::RegisterPilot(ABaseCharacter* Pilot)
+{
+	int32 Slot = Slots.IndexOfByPredicate([](const TWeakObjectPtr<ABaseCharacter>& SlotPilot) { return !SlotPilot.IsValid(); });
+	if (Slot == INDEX_NONE)
+	{
+		Slot = Slots.Num();
+		History.SetNumSlots(Slots.Num() * 2);
+		Slots.SetNum(History.GetNumSlots());
+		UE_LOG(LogTemp, Log, TEXT("Rewind history grew to %d pilot slots"), History.GetNumSlots());
+	}
+
+	History.ClearSlot(Slot);
+	History.SetSlotRadius(Slot, Pilot->GetCapsuleComponent()->GetScaledCapsuleRadius());
+	Slots[Slot] = Pilot;
+}
+
+void UPilotRewindSubsystem::UnregisterPilot(ABaseCharacter* Pilot)
+{
+	const int32 Slot = Slots.IndexOfByKey(Pilot);
+	if (Slot == INDEX_NONE)
+	{
+		return;
+	}
+
+	Slots[Slot] = nullptr;
+	History.ClearSlot(Slot);
+}
+
+void UPilotRewindSubsystem::Tick(float DeltaTime)
+{
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const double Timestamp = GetWorld()->GetTimeSeconds();
+	if (Timestamp - History.GetNewestTime() >= RecordInterval)
+	{
+		RecordFrame(Timestamp);
+	}
+}
+
+void UPilotRewindSubsystem::RecordFrame(double Timestamp)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PilotRewindRecord);
+
+	FPilotRewindSample* Row = History.AddFrame(Timestamp);
+	for (int32 Slot = 0; Slot < Slots.Num(); ++Slot)
+	{
+		const ABaseCharacter* Pilot = Slots[Slot].Get();
+		if (!Pilot)
+		{
+			Row[Slot].bValid = 0;
+			continue;
+		}
+
+		FPilotRewindHistory::Quantize(Row[Slot], Pilot->GetActorLocation(), Pilot->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+	}
+}
+
+bool UPilotRewindSubsystem::RewindSegmentTest(double Timestamp, const FVector& Start, const FVector& End, ABaseCharacter*& OutPilot, FVector& OutHitLocation) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_PilotRewindHitTest);
+
+	const int32 Slot = History.SegmentTest(Timestamp, Start, End, OutHitLocation);
+	OutPilot = Slot != INDEX_NONE ? Slots[Slot].Get() : nullptr;
+	return OutPilot != nullptr;
+}
+
+TStatId UPilotRewindSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPilotRewindSubsystem, STATGROUP_Tickables);
+}
+
+// Fills a standalone history with pilots running and crouching on a grid, then shoots at random
+// pilots at random points in the history. Uses the same cvars as the subsystem.
+static void BenchmarkRewind(const TArray<FString>& Args)
+{
+	const int32 NumPilots = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 64;
+	const int32 Iterations = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 10000;
+	const int32 NumFrames = GetRewindHistoryFrames();
+	const double FrameInterval = 1.0 / GetRewindMaxTickRate();
+	const float Radius = 34.f;
+	const float StandingHalfHeight = 88.f;
+	const float CrouchedHalfHeight = 44.f;
+	const float Speed = 1500.f;
+
+	FRandomStream RandomStream(0);
+	auto RandomDirection2D = [&RandomStream]()
+	{
+		const float Angle = RandomStream.FRandRange(0.f, 2.f * PI);
+		return FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+	};
+
+	TArray<FVector> Origins;
+	TArray<FVector> Directions;
+	for (int32 Pilot = 0; Pilot < NumPilots; ++Pilot)
+	{
+		Origins.Add(FVector((Pilot % 8) * 500.f, (Pilot / 8) * 500.f, StandingHalfHeight));
+		Directions.Add(RandomDirection2D());
+	}
+
+	FPilotRewindHistory History;
+	History.Init(NumPilots, NumFrames);
+	for (int32 Pilot = 0; Pilot < NumPilots; ++Pilot)
+	{
+		History.SetSlotRadius(Pilot, Radius);
+	}
+
+	auto GetLocation = [&](int32 Pilot, double Time)
+	{
+		return Origins[Pilot] + Directions[Pilot] * Speed * static_cast<float>(Time);
+	};
+
+	uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const double Time = Frame * FrameInterval;
+		FPilotRewindSample* Row = History.AddFrame(Time);
+		for (int32 Pilot = 0; Pilot < NumPilots; ++Pilot)
+		{
+			const float HalfHeight = (Pilot + Frame) % 16 < 8 ? StandingHalfHeight : CrouchedHalfHeight;
+			FPilotRewindHistory::Quantize(Row[Pilot], GetLocation(Pilot, Time), HalfHeight);
+		}
+	}
+	const double RecordUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / NumFrames;
+
+	const double HistorySeconds = (NumFrames - 1) * FrameInterval;
+	int32 NumHits = 0;
+	StartCycles = FPlatformTime::Cycles64();
+	for (int32 i = 0; i < Iterations; ++i)
+	{
+		const double Time = RandomStream.FRandRange(0.f, static_cast<float>(HistorySeconds));
+		const FVector Target = GetLocation(RandomStream.RandHelper(NumPilots), Time);
+		const FVector Start = Target + (RandomDirection2D() + FVector(0.f, 0.f, .1f)) * 3000.f;
+
+		FVector HitLocation;
+		NumHits += History.SegmentTest(Time, Start, Target, HitLocation) != INDEX_NONE;
+	}
+	const double HitTestUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / Iterations;
+
+	UE_LOG(LogTemp, Log, TEXT("Rewind benchmark: %d pilots, %d frames (%.0fms), record %.2fus/frame, rewind + hit test %.2fus/query, %d/%d hits"),
+		NumPilots,
+		NumFrames,
+		HistorySeconds * 1000.0,
+		RecordUs,
+		HitTestUs,
+		NumHits,
+		Iterations
+	);
+}
+
+static FAutoConsoleCommand PilotBenchmarkRewindCommand(
+	TEXT("pilot.BenchmarkRewind"),
+	TEXT("Times lag compensation recording and rewind + hit tests. Arguments: pilots (default 64), iterations (default 10000)."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkRewind)
+);
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PilotRewindSubsystem.generated.h"
+
+class ABaseCharacter;
+
+// Pilot capsule at one recorded frame, positions and heights in 1/16 cm.
+struct FPilotRewindSample
+{
+	int32 X;
+	int32 Y;
+	int32 Z;
+	uint16 HalfHeight;
+	uint16 bValid;
+};
+static_assert(sizeof(FPilotRewindSample) == 16, "FPilotRewindSample should stay compact");
+
+/**
+ * Ring of recorded frames, each frame one contiguous row with a sample per slot,
+ * so rewinding every slot to a timestamp is a single pass over two rows.
+ */
+class TF2PILOTMOVEMENT_API FPilotRewindHistory
+{
+public:
+	static constexpr float QuantizeScale = 16.f;
+
+	void Init(int32 InNumSlots, int32 InNumFrames);
+	// Widens every row to InNumSlots, recorded history is kept.
+	void SetNumSlots(int32 InNumSlots);
+	int32 GetNumSlots() const { return NumSlots; }
+	int32 GetNumFrames() const { return NumFrames; }
+	double GetNewestTime() const { return NumFrames > 0 ? FrameTimes[NewestFrame] : TNumericLimits<double>::Lowest(); }
+
+	void SetSlotRadius(int32 Slot, float Radius) { SlotRadii[Slot] = Radius; }
+	// A slot's old history must not be attributed to whoever takes it next.
+	void ClearSlot(int32 Slot);
+
+	// Starts a new frame, overwriting the oldest one, and returns its row of GetNumSlots() samples.
+	FPilotRewindSample* AddFrame(double Timestamp);
+	static void Quantize(FPilotRewindSample& Sample, const FVector& Location, float HalfHeight);
+
+	// Tests the segment against every slot's capsule as it was at Timestamp, clamped to the recorded history.
+	// Returns the slot closest to Start, with the closest point on the segment as OutHitLocation, or INDEX_NONE.
+	int32 SegmentTest(double Timestamp, const FVector& Start, const FVector& End, FVector& OutHitLocation) const;
+
+private:
+	const FPilotRewindSample* GetFrameRow(int32 FrameIndex) const { return &Samples[FrameIndex * NumSlots]; }
+
+	int32 NumSlots = 0;
+	int32 MaxFrames = 0;
+
+	// [MaxFrames][NumSlots], row NewestFrame was written last
+	TArray<FPilotRewindSample> Samples;
+	TArray<double> FrameTimes;
+	TArray<float> SlotRadii;
+	int32 NewestFrame = INDEX_NONE;
+	int32 NumFrames = 0;
+};
+
+/**
+ * Server-side lag compensation history for all pilots.
+ * A frame is recorded at most pilot.RewindMaxTickRate times per second and enough frames are kept to
+ * cover pilot.RewindHistorySeconds whatever the server tick rate. Rows start at pilot.RewindMaxPilots
+ * slots and double when more pilots register. pilot.BenchmarkRewind times recording and hit tests.
+ */
+UCLASS()
+class TF2PILOTMOVEMENT_API UPilotRewindSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterPilot(ABaseCharacter* Pilot);
+	void UnregisterPilot(ABaseCharacter* Pilot);
+
+	// Tests the segment against every pilot's capsule as it was at Timestamp (world time seconds).
+	// Returns the pilot closest to Start, with the closest point on the segment as OutHitLocation.
+	bool RewindSegmentTest(double Timestamp, const FVector& Start, const FVector& End, ABaseCharacter*& OutPilot, FVector& OutHitLocation) const;
+
+private:
+	void RecordFrame(double Timestamp);
+
+	FPilotRewindHistory History;
+	double RecordInterval = 0.0;
+	TArray<TWeakObjectPtr<ABaseCharacter>> Slots;
+};
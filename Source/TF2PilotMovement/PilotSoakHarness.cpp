@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotSoakHarness.h"
+#include "BaseCharacter.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+
+APilotSoakHarness::APilotSoakHarness() :
+	NumPilots(1000),
+	InputMode(EPilotSoakInputMode::SIM_Random),
+	PilotSpacing(300.f),
+	DurationSeconds(3600.f),
+	MinInputInterval(.05f),
+	MaxInputInterval(.5f),
+	ReportInterval(60.f),
+	RandomSeed(0),
+	MaxLoggedFailures(20),
+	bQuitWhenFinished(true),
+	ElapsedTime(0.f),
+	NextReportTime(0.f),
+	bFinished(false),
+	InvariantFailures(0),
+	GroundJumps(0),
+	LastFrameSeconds(0.0),
+	FrameTimeSum(0.0),
+	FrameTimeMax(0.0),
+	FrameCount(0),
+	BaselineFrameTimeMs(-1.0),
+	BaselineUsedMemoryMB(-1.0)
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void APilotSoakHarness::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RandomStream.Initialize(RandomSeed);
+	NextReportTime = ReportInterval;
+	LastFrameSeconds = FPlatformTime::Seconds();
+
+	SpawnPilots();
+}
+
+void APilotSoakHarness::SpawnPilots()
+{
+	if (!PilotClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("PilotSoakHarness has no PilotClass"));
+		return;
+	}
+
+	// Pilots that fall to KillZ are destroyed and the soak silently tests nothing.
+	FHitResult FloorHit;
+	if (!GetWorld()->LineTraceSingleByChannel(FloorHit, GetActorLocation(), GetActorLocation() - FVector(0.f, 0.f, 10000.f), ECC_Visibility))
+	{
+		UE_LOG(LogTemp, Error, TEXT("PilotSoakHarness found no floor below %s, pilots will fall to KillZ"), *GetActorLocation().ToString());
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumPilots)));
+	for (int32 i = 0; i < NumPilots; ++i)
+	{
+		const FVector Location = GetActorLocation() + FVector(
+			(i % GridSize) * PilotSpacing,
+			(i / GridSize) * PilotSpacing,
+			0.f
+		);
+		ABaseCharacter* Pilot = GetWorld()->SpawnActor<ABaseCharacter>(PilotClass, Location, FRotator::ZeroRotator, SpawnParameters);
+		if (!Pilot)
+		{
+			continue;
+		}
+		// No controller is spawned, the harness is the only input source.
+		Pilot->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+		Pilots.Add(Pilot);
+		NextInputTimes.Add(RandomStream.FRandRange(0.f, MaxInputInterval));
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("PilotSoakHarness spawned %d pilots"), Pilots.Num());
+}
+
+void APilotSoakHarness::DriveRandomInput(ABaseCharacter* Pilot)
+{
+	switch (RandomStream.RandRange(0, 7))
+	{
+	case 0:
+		Pilot->bInputForward ? Pilot->MoveForwardStop() : Pilot->MoveForward();
+		break;
+	case 1:
+		Pilot->bInputBackward ? Pilot->MoveBackwardStop() : Pilot->MoveBackward();
+		break;
+	case 2:
+		Pilot->bInputRight ? Pilot->MoveRightStop() : Pilot->MoveRight();
+		break;
+	case 3:
+		Pilot->bInputLeft ? Pilot->MoveLeftStop() : Pilot->MoveLeft();
+		break;
+	case 4:
+		Jump(Pilot);
+		break;
+	case 5:
+		Pilot->bIsCrouching ? Pilot->CustomStopCrouch() : Pilot->CustomStartCrouch();
+		break;
+	case 6:
+		Pilot->SprintOrWalk();
+		break;
+	default:
+		Pilot->SetActorRotation(FRotator(0.f, RandomStream.FRandRange(-180.f, 180.f), 0.f));
+		break;
+	}
+}
+
+void APilotSoakHarness::DriveBunnyHop(ABaseCharacter* Pilot)
+{
+	if (!Pilot->bInputForward)
+	{
+		Pilot->MoveForward();
+	}
+	// Land is set by Landed, so this jumps on the first frame back on the ground.
+	if (Pilot->MovementStatus == EMovementStatus::MS_Land)
+	{
+		Jump(Pilot);
+	}
+}
+
+void APilotSoakHarness::DriveCrouchSpam(ABaseCharacter* Pilot)
+{
+	if (!Pilot->bInputForward)
+	{
+		Pilot->MoveForward();
+	}
+	Pilot->bIsCrouching ? Pilot->CustomStopCrouch() : Pilot->CustomStartCrouch();
+}
+
+void APilotSoakHarness::Jump(ABaseCharacter* Pilot)
+{
+	const bool bWasOnGround = Pilot->MovementStatus == EMovementStatus::MS_Land;
+	Pilot->CustomJump();
+	if (bWasOnGround && Pilot->MovementStatus != EMovementStatus::MS_Land)
+	{
+		++GroundJumps;
+	}
+}
+
+void APilotSoakHarness::CheckInvariants()
+{
+	FString Failure;
+	for (ABaseCharacter* Pilot : Pilots)
+	{
+		if (IsValid(Pilot) && !Pilot->CheckMovementInvariants(Failure))
+		{
+			if (InvariantFailures < MaxLoggedFailures)
+			{
+				UE_LOG(LogTemp, Error, TEXT("%s at %.2fs: %s"), *Pilot->GetName(), ElapsedTime, *Failure);
+			}
+			++InvariantFailures;
+		}
+	}
+}
+
+void APilotSoakHarness::Report(bool bFinal)
+{
+	const double AvgFrameTimeMs = FrameCount > 0 ? FrameTimeSum / FrameCount * 1000.0 : 0.0;
+	const double UsedMemoryMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	if (BaselineFrameTimeMs < 0.0)
+	{
+		BaselineFrameTimeMs = AvgFrameTimeMs;
+		BaselineUsedMemoryMB = UsedMemoryMB;
+	}
+
+	UE_LOG(LogTemp, Log,
+		TEXT("PilotSoakHarness%s %.0fs: %d pilots, frame avg %.2fms max %.2fms (drift %+.2fms), memory %.1fMB (drift %+.1fMB), ground jumps %lld, invariant failures %lld"),
+		bFinal ? TEXT(" finished") : TEXT(""),
+		ElapsedTime,
+		Pilots.Num(),
+		AvgFrameTimeMs,
+		FrameTimeMax * 1000.0,
+		AvgFrameTimeMs - BaselineFrameTimeMs,
+		UsedMemoryMB,
+		UsedMemoryMB - BaselineUsedMemoryMB,
+		GroundJumps,
+		InvariantFailures
+	);
+
+	FrameTimeSum = 0.0;
+	FrameTimeMax = 0.0;
+	FrameCount = 0;
+	GroundJumps = 0;
+}
+
+void APilotSoakHarness::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	const double NowSeconds = FPlatformTime::Seconds();
+	const double FrameSeconds = NowSeconds - LastFrameSeconds;
+	LastFrameSeconds = NowSeconds;
+	FrameTimeSum += FrameSeconds;
+	FrameTimeMax = FMath::Max(FrameTimeMax, FrameSeconds);
+	++FrameCount;
+
+	ElapsedTime += DeltaTime;
+
+	for (int32 i = 0; i < Pilots.Num(); ++i)
+	{
+		if (!IsValid(Pilots[i]))
+		{
+			continue;
+		}
+		if (InputMode == EPilotSoakInputMode::SIM_BunnyHop)
+		{
+			DriveBunnyHop(Pilots[i]);
+		}
+		else if (InputMode == EPilotSoakInputMode::SIM_CrouchSpam)
+		{
+			DriveCrouchSpam(Pilots[i]);
+		}
+		else if (ElapsedTime >= NextInputTimes[i])
+		{
+			DriveRandomInput(Pilots[i]);
+			NextInputTimes[i] = ElapsedTime + RandomStream.FRandRange(MinInputInterval, MaxInputInterval);
+		}
+	}
+
+	CheckInvariants();
+
+	if (ElapsedTime >= NextReportTime)
+	{
+		Report(false);
+		NextReportTime += ReportInterval;
+	}
+
+	if (ElapsedTime >= DurationSeconds)
+	{
+		Report(true);
+		bFinished = true;
+		if (bQuitWhenFinished)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+	}
+}
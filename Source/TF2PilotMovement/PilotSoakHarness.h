@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "PilotSoakHarness.generated.h"
+
+class ABaseCharacter;
+
+UENUM()
+enum class EPilotSoakInputMode : uint8
+{
+	// Randomized input every MinInputInterval to MaxInputInterval
+	SIM_Random			UMETA(DisplayName = "Random"),
+	// Forward held and a jump on every landing, to measure the per-jump overhead
+	SIM_BunnyHop		UMETA(DisplayName = "BunnyHop"),
+	// Forward held and crouch toggled every frame, to measure capsule updates and stand-up queries
+	SIM_CrouchSpam		UMETA(DisplayName = "CrouchSpam"),
+
+	DefaultMax			UMETA(DisplayName = "DefaultMax")
+};
+
+/**
+ * Spawns a crowd of pilots, drives them with randomized input and checks movement invariants every frame.
+ * Meant to run headless, e.g. a map containing this actor above a flat floor that covers the spawn grid
+ * (NumPilots at PilotSpacing), launched with -game -nullrhi -unattended. Without a floor the pilots fall to KillZ.
+ * Logs frame time and memory drift every ReportInterval and exits when DurationSeconds has passed.
+ * InputMode BunnyHop replaces the random input with a jump on every landing, compare its frame time and
+ * stat PilotMovement against a Random run with the same pilot count for the cost per jump. CrouchSpam toggles
+ * crouch every frame, run it with pilot.CapsuleCommitEveryFrame 0 and 1 to compare Capsule Shape Updates.
+ */
+UCLASS()
+class TF2PILOTMOVEMENT_API APilotSoakHarness : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APilotSoakHarness();
+
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	void SpawnPilots();
+	void DriveRandomInput(ABaseCharacter* Pilot);
+	void DriveBunnyHop(ABaseCharacter* Pilot);
+	void DriveCrouchSpam(ABaseCharacter* Pilot);
+	void Jump(ABaseCharacter* Pilot);
+	void CheckInvariants();
+	void Report(bool bFinal);
+
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	TSubclassOf<ABaseCharacter> PilotClass;
+	UPROPERTY(EditAnywhere, Category = "Soak", meta = (ClampMin = "1"))
+	int32 NumPilots;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	EPilotSoakInputMode InputMode;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	float PilotSpacing;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	float DurationSeconds;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	float MinInputInterval;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	float MaxInputInterval;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	float ReportInterval;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	int32 RandomSeed;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	int32 MaxLoggedFailures;
+	UPROPERTY(EditAnywhere, Category = "Soak")
+	bool bQuitWhenFinished;
+
+	UPROPERTY(Transient)
+	TArray<ABaseCharacter*> Pilots;
+	TArray<float> NextInputTimes;
+
+	FRandomStream RandomStream;
+	float ElapsedTime;
+	float NextReportTime;
+	bool bFinished;
+
+	int64 InvariantFailures;
+	// Jumps off the ground since the last report
+	int64 GroundJumps;
+
+	// Frame time and memory since the last report, and from the first report as drift baseline
+	double LastFrameSeconds;
+	double FrameTimeSum;
+	double FrameTimeMax;
+	int32 FrameCount;
+	double BaselineFrameTimeMs;
+	double BaselineUsedMemoryMB;
+};
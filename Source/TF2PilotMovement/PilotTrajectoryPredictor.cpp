@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotTrajectoryPredictor.h"
+
+namespace
+{
+	// Braking follows dv/dt = -Friction * v - Deceleration, as in UCharacterMovementComponent::ApplyVelocityBraking.
+	float BrakeTimeToSpeed(float Speed, float TargetSpeed, float Friction, float Deceleration)
+	{
+		if (Speed <= TargetSpeed)
+		{
+			return 0.f;
+		}
+		if (Friction > KINDA_SMALL_NUMBER)
+		{
+			const float Offset = Deceleration / Friction;
+			if (TargetSpeed + Offset <= KINDA_SMALL_NUMBER)
+			{
+				return BIG_NUMBER;
+			}
+			return FMath::Loge((Speed + Offset) / (TargetSpeed + Offset)) / Friction;
+		}
+		return Deceleration > KINDA_SMALL_NUMBER ? (Speed - TargetSpeed) / Deceleration : BIG_NUMBER;
+	}
+
+	float BrakeDistance(float Speed, float Friction, float Deceleration, float Time)
+	{
+		Time = FMath::Min(Time, BrakeTimeToSpeed(Speed, 0.f, Friction, Deceleration));
+		if (Friction > KINDA_SMALL_NUMBER)
+		{
+			const float Offset = Deceleration / Friction;
+			return (Speed + Offset) * (1.f - FMath::Exp(-Friction * Time)) / Friction - Offset * Time;
+		}
+		return Speed * Time - .5f * Deceleration * Time * Time;
+	}
+
+	FVector PredictGround(const FPilotTrajectoryParams& Params, const FVector& Location, const FVector& Velocity, float Time)
+	{
+		const FVector VelocityXY(Velocity.X, Velocity.Y, 0.f);
+		const float Speed = VelocityXY.Size();
+		if (Speed <= KINDA_SMALL_NUMBER || Time <= 0.f)
+		{
+			return Location;
+		}
+		const float Distance = BrakeDistance(
+			Speed,
+			Params.GroundFriction * Params.BrakingFrictionFactor,
+			Params.BrakingDeceleration,
+			Time
+		);
+		return Location + VelocityXY / Speed * Distance;
+	}
+
+	FVector PredictSlide(const FPilotTrajectoryParams& Params, const FVector& Location, const FVector& Velocity, bool bBoost, float Time)
+	{
+		const FVector VelocityXY(Velocity.X, Velocity.Y, 0.f);
+		float Speed = VelocityXY.Size();
+		if (Speed <= KINDA_SMALL_NUMBER)
+		{
+			return Location;
+		}
+		const FVector Direction = VelocityXY / Speed;
+		if (bBoost)
+		{
+			Speed += Params.SlideBoostForce;
+		}
+
+		// Slide friction until ABaseCharacter::Tick stops the slide, default friction afterwards.
+		const float SlideFriction = Params.SlideGroundFriction * Params.BrakingFrictionFactor;
+		const float SlideTime = FMath::Min(
+			Time,
+			BrakeTimeToSpeed(Speed, Params.SlideStopSpeed, SlideFriction, Params.SlideBrakingDeceleration)
+		);
+		const FVector SlideEnd = Location + Direction * BrakeDistance(Speed, SlideFriction, Params.SlideBrakingDeceleration, SlideTime);
+		if (SlideTime >= Time)
+		{
+			return SlideEnd;
+		}
+		return PredictGround(Params, SlideEnd, Direction * FMath::Min(Speed, Params.SlideStopSpeed), Time - SlideTime);
+	}
+
+	float TimeToLand(const FVector& Location, const FVector& Velocity, float FloorZ, float GravityZ)
+	{
+		if (GravityZ >= 0.f)
+		{
+			return BIG_NUMBER;
+		}
+		const float Discriminant = Velocity.Z * Velocity.Z - 2.f * GravityZ * (Location.Z - FloorZ);
+		if (Discriminant < 0.f || !FMath::IsFinite(Discriminant))
+		{
+			return BIG_NUMBER;
+		}
+		return (Velocity.Z + FMath::Sqrt(Discriminant)) / -GravityZ;
+	}
+
+	// Advances a ballistic arc by at most Duration. Returns true when the pilot lands on FloorZ first.
+	bool AdvanceFlight(const FPilotTrajectoryParams& Params, FVector& Location, FVector& Velocity, float FloorZ, float& Time, float Duration)
+	{
+		const float LandTime = TimeToLand(Location, Velocity, FloorZ, Params.GravityZ);
+		const float Step = FMath::Min3(Time, Duration, LandTime);
+		Location += Velocity * Step;
+		Location.Z += .5f * Params.GravityZ * Step * Step;
+		Velocity.Z += Params.GravityZ * Step;
+		Time -= Step;
+		if (Step >= LandTime)
+		{
+			Location.Z = FloorZ;
+			Velocity.Z = 0.f;
+			return true;
+		}
+		return false;
+	}
+
+	FVector PredictFlight(
+		const FPilotTrajectoryParams& Params,
+		FVector Location,
+		FVector Velocity,
+		float FloorZ,
+		float DoubleJumpDelay,
+		float Time)
+	{
+		if (DoubleJumpDelay >= 0.f)
+		{
+			if (AdvanceFlight(Params, Location, Velocity, FloorZ, Time, DoubleJumpDelay))
+			{
+				return PredictGround(Params, Location, Velocity, Time);
+			}
+			if (Time <= 0.f)
+			{
+				return Location;
+			}
+			Velocity.Z = Params.JumpZVelocity;
+		}
+		if (AdvanceFlight(Params, Location, Velocity, FloorZ, Time, BIG_NUMBER))
+		{
+			return PredictGround(Params, Location, Velocity, Time);
+		}
+		return Location;
+	}
+
+	float TimeToApex(const FPilotTrajectoryParams& Params, float VelocityZ)
+	{
+		return Params.GravityZ < 0.f ? FMath::Max(VelocityZ / -Params.GravityZ, 0.f) : -1.f;
+	}
+}
+
+FVector FPilotTrajectoryPredictor::PredictLocation(
+	const FPilotTrajectoryParams& Params,
+	const FPilotTrajectoryState& State,
+	EPilotPredictedAction Action,
+	float Time)
+{
+	if (State.bIsFalling)
+	{
+		FVector Velocity = State.Velocity;
+		float DoubleJumpDelay = -1.f;
+		if (State.bCanDoubleJump)
+		{
+			if (Action == EPilotPredictedAction::Jump)
+			{
+				Velocity.Z = Params.JumpZVelocity;
+			}
+			else if (Action == EPilotPredictedAction::JumpThenDoubleJumpAtApex)
+			{
+				DoubleJumpDelay = TimeToApex(Params, Velocity.Z);
+			}
+		}
+		return PredictFlight(Params, State.Location, Velocity, State.FloorZ, DoubleJumpDelay, Time);
+	}
+
+	switch (Action)
+	{
+	case EPilotPredictedAction::Slide:
+		if (!State.bIsSliding && FVector(State.Velocity.X, State.Velocity.Y, 0.f).Size() > Params.SlideStartSpeed)
+		{
+			return PredictSlide(Params, State.Location, State.Velocity, State.bCanSlideBoost, Time);
+		}
+		break;
+	case EPilotPredictedAction::Jump:
+	case EPilotPredictedAction::JumpThenDoubleJumpAtApex:
+	{
+		FVector Velocity(State.Velocity.X, State.Velocity.Y, Params.JumpZVelocity);
+		if (!State.bCanMaxJump)
+		{
+			Velocity.Z *= Params.InstantJumpMultiplier;
+		}
+		const float DoubleJumpDelay =
+			Action == EPilotPredictedAction::JumpThenDoubleJumpAtApex && State.bCanDoubleJump ?
+			TimeToApex(Params, Velocity.Z) :
+			-1.f;
+		return PredictFlight(Params, State.Location, Velocity, State.Location.Z, DoubleJumpDelay, Time);
+	}
+	default:
+		break;
+	}
+
+	if (State.bIsSliding)
+	{
+		return PredictSlide(Params, State.Location, State.Velocity, false, Time);
+	}
+	return PredictGround(Params, State.Location, State.Velocity, Time);
+}
+
+void FPilotTrajectoryPredictor::PredictLocations(
+	const FPilotTrajectoryParams& Params,
+	TArrayView<const FPilotTrajectoryQuery> Queries,
+	TArrayView<FVector> OutLocations)
+{
+	check(Queries.Num() == OutLocations.Num());
+
+	for (int32 i = 0; i < Queries.Num(); ++i)
+	{
+		const FPilotTrajectoryQuery& Query = Queries[i];
+		OutLocations[i] = PredictLocation(Params, Query.State, Query.Action, Query.Time);
+	}
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EPilotPredictedAction : uint8
+{
+	None,
+	Slide,
+	Jump,
+	JumpThenDoubleJumpAtApex,
+};
+
+// Movement tuning that determines a pilot's short-horizon trajectory. All speeds in cm/s.
+struct FPilotTrajectoryParams
+{
+	float GravityZ = -980.f;
+	float JumpZVelocity = 625.f;
+	float InstantJumpMultiplier = .88f;
+	float SlideStartSpeed = 555.56f;
+	float SlideStopSpeed = 277.78f;
+	float SlideBoostForce = 200.f;
+	float SlideGroundFriction = .1f;
+	float SlideBrakingDeceleration = 200.f;
+	float GroundFriction = 8.f;
+	float BrakingDeceleration = 2048.f;
+	float BrakingFrictionFactor = 2.f;
+};
+
+struct FPilotTrajectoryState
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	// Height the pilot lands on. Must be finite, use the world's KillZ when unknown.
+	float FloorZ = -1048575.f;
+	bool bIsFalling = false;
+	bool bIsSliding = false;
+	bool bCanMaxJump = true;
+	bool bCanDoubleJump = true;
+	bool bCanSlideBoost = true;
+};
+
+struct FPilotTrajectoryQuery
+{
+	FPilotTrajectoryState State;
+	EPilotPredictedAction Action = EPilotPredictedAction::None;
+	float Time = 0.f;
+};
+
+/**
+ * Closed-form pilot trajectory prediction, matching ABaseCharacter's jump and slide rules and
+ * UCharacterMovementComponent's braking model. Assumes no further movement input after the action,
+ * flat floors and no collision other than landing on FloorZ.
+ */
+struct TF2PILOTMOVEMENT_API FPilotTrajectoryPredictor
+{
+	static FVector PredictLocation(
+		const FPilotTrajectoryParams& Params,
+		const FPilotTrajectoryState& State,
+		EPilotPredictedAction Action,
+		float Time
+	);
+
+	// OutLocations must be the same size as Queries.
+	static void PredictLocations(
+		const FPilotTrajectoryParams& Params,
+		TArrayView<const FPilotTrajectoryQuery> Queries,
+		TArrayView<FVector> OutLocations
+	);
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PilotWorkScheduler.h"
+#include "BaseCharacter.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "TF2PilotMovement.h"
+
+static TAutoConsoleVariable<float> CVarPilotDeferredWorkBudgetMs(
+	TEXT("pilot.DeferredWorkBudgetMs"),
+	2.f,
+	TEXT("Time per frame for deferrable pilot work (camera, FOV, friction curve, debug). 0 or less runs everything every frame."),
+	ECVF_Default
+);
+
+DECLARE_CYCLE_STAT(TEXT("Deferred Pilot Work"), STAT_PilotDeferredWork, STATGROUP_PilotMovement);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Degradation Level"), STAT_PilotDegradationLevel, STATGROUP_PilotMovement);
+
+void UPilotWorkScheduler::RegisterPilot(ABaseCharacter* Pilot)
+{
+	Entries.Add({ Pilot, 0.f, false });
+}
+
+void UPilotWorkScheduler::UnregisterPilot(ABaseCharacter* Pilot)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Pilot](const FPilotEntry& Entry) { return Entry.Pilot.Get() == Pilot; });
+	if (Index != INDEX_NONE)
+	{
+		// Keep the round-robin order so no pilot loses its turn.
+		Entries.RemoveAt(Index);
+		if (Index < Cursor)
+		{
+			--Cursor;
+		}
+		if (Cursor >= Entries.Num())
+		{
+			Cursor = 0;
+		}
+	}
+}
+
+void UPilotWorkScheduler::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PilotDeferredWork);
+
+	const int32 NumEntries = Entries.Num();
+	int32 NumScheduled = 0;
+	for (FPilotEntry& Entry : Entries)
+	{
+		// The local player's pilot runs its deferred work in its own Tick and doesn't count toward degradation.
+		const ABaseCharacter* Pilot = Entry.Pilot.Get();
+		Entry.bScheduled = Pilot && !Pilot->IsLocalPlayerPilot();
+		if (Entry.bScheduled)
+		{
+			Entry.PendingDeltaTime += DeltaTime;
+			++NumScheduled;
+		}
+		else
+		{
+			Entry.PendingDeltaTime = 0.f;
+		}
+	}
+
+	const double BudgetSeconds = CVarPilotDeferredWorkBudgetMs.GetValueOnGameThread() / 1000.0;
+	const double StartSeconds = FPlatformTime::Seconds();
+	int32 NumVisited = 0;
+	int32 NumProcessed = 0;
+	while (NumVisited < NumEntries && NumProcessed < NumScheduled)
+	{
+		FPilotEntry& Entry = Entries[Cursor];
+		Cursor = (Cursor + 1) % NumEntries;
+		++NumVisited;
+		if (!Entry.bScheduled)
+		{
+			continue;
+		}
+		++NumProcessed;
+
+		Entry.Pilot->TickDeferredWork(Entry.PendingDeltaTime);
+		Entry.PendingDeltaTime = 0.f;
+
+		if (BudgetSeconds > 0.0 && FPlatformTime::Seconds() - StartSeconds >= BudgetSeconds)
+		{
+			break;
+		}
+	}
+
+	DegradationLevel = NumScheduled > 0 ? 1.f - static_cast<float>(NumProcessed) / NumScheduled : 0.f;
+	SET_FLOAT_STAT(STAT_PilotDegradationLevel, DegradationLevel);
+}
+
+TStatId UPilotWorkScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPilotWorkScheduler, STATGROUP_Tickables);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PilotWorkScheduler.generated.h"
+
+class ABaseCharacter;
+
+/**
+ * Runs the deferrable part of every pilot's tick (camera tilt, FOV, friction curve, debug traces)
+ * within a per-frame time budget set by pilot.DeferredWorkBudgetMs.
+ * Pilots that don't fit are picked up first next frame with their accumulated delta time.
+ * The local player's pilot is skipped, it ticks its deferred work itself at full rate. AI and remote pilots
+ * are always scheduled, even when IsLocallyControlled is true for them (AI on a server, Standalone).
+ */
+UCLASS()
+class TF2PILOTMOVEMENT_API UPilotWorkScheduler : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterPilot(ABaseCharacter* Pilot);
+	void UnregisterPilot(ABaseCharacter* Pilot);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Fraction of pilots whose deferred work was skipped last frame, 0 when running at full quality.
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	float GetDegradationLevel() const { return DegradationLevel; }
+
+private:
+	struct FPilotEntry
+	{
+		TWeakObjectPtr<ABaseCharacter> Pilot;
+		float PendingDeltaTime;
+		bool bScheduled;
+	};
+
+	TArray<FPilotEntry> Entries;
+	int32 Cursor = 0;
+	float DegradationLevel = 0.f;
+};
@@ -4,3 +4,4 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("PilotMovement"), STATGROUP_PilotMovement, STATCAT_Advanced);
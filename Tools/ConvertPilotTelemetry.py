@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Converts pilot movement telemetry (.pmt) files written by FPilotMovementTelemetry to CSV or Parquet.
+
+Usage:
+    ConvertPilotTelemetry.py Saved/Telemetry/Pilot_1.pmt [more.pmt ...] [--format csv|parquet] [--output-dir DIR]
+
+CSV needs only the standard library, Parquet needs pyarrow.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import zlib
+
+FILE_MAGIC = 0x4C544D50  # "PMTL"
+FILE_VERSION = 2
+
+FILE_HEADER = struct.Struct("<II")
+BLOCK_HEADER = struct.Struct("<IIII")
+
+COLUMNS = ("time_seconds", "velocity_xy_kph", "ground_friction_multiplier", "movement_status", "events")
+
+# EMovementStatus values
+STATUS_NAMES = ("Land", "Wallrun", "Fall", "JumpBeforeApex", "Slide")
+
+EVENT_NAMES = ("SlideStart", "SlideStop", "InstantJump", "MaxJump", "DoubleJump")
+
+
+def read_blocks(path):
+    with open(path, "rb") as file:
+        data = file.read()
+
+    magic, version = FILE_HEADER.unpack_from(data, 0)
+    if magic != FILE_MAGIC:
+        raise ValueError("%s is not a pilot telemetry file" % path)
+    if version != FILE_VERSION:
+        raise ValueError("%s has version %d, expected %d" % (path, version, FILE_VERSION))
+
+    blocks = []
+    offset = FILE_HEADER.size
+    while offset + BLOCK_HEADER.size <= len(data):
+        first_sample, num_samples, uncompressed_size, compressed_size = BLOCK_HEADER.unpack_from(data, offset)
+        offset += BLOCK_HEADER.size
+        payload = data[offset:offset + compressed_size]
+        offset += compressed_size
+        if len(payload) < compressed_size:
+            print("%s: truncated block at sample %d, skipped" % (path, first_sample), file=sys.stderr)
+            break
+
+        columns = zlib.decompress(payload)
+        if len(columns) != uncompressed_size or uncompressed_size != num_samples * 14:
+            raise ValueError("%s: corrupt block at sample %d" % (path, first_sample))
+        blocks.append((first_sample, num_samples, columns))
+
+    # The background writer may append blocks out of order.
+    blocks.sort(key=lambda block: block[0])
+    return blocks
+
+
+def decode_block(num_samples, columns):
+    floats = struct.unpack_from("<%df" % (3 * num_samples), columns, 0)
+    bytes_offset = 12 * num_samples
+    return (
+        floats[0:num_samples],
+        floats[num_samples:2 * num_samples],
+        floats[2 * num_samples:3 * num_samples],
+        columns[bytes_offset:bytes_offset + num_samples],
+        columns[bytes_offset + num_samples:bytes_offset + 2 * num_samples],
+    )
+
+
+def read_columns(path):
+    result = [[] for _ in COLUMNS]
+    expected_sample = None
+    for first_sample, num_samples, columns in read_blocks(path):
+        if expected_sample is not None and first_sample != expected_sample:
+            print("%s: samples %d to %d are missing" % (path, expected_sample, first_sample - 1), file=sys.stderr)
+        expected_sample = first_sample + num_samples
+        for column, values in zip(result, decode_block(num_samples, columns)):
+            column.extend(values)
+    return result
+
+
+def status_name(status):
+    return STATUS_NAMES[status] if status < len(STATUS_NAMES) else str(status)
+
+
+def event_names(events):
+    return "|".join(name for bit, name in enumerate(EVENT_NAMES) if events & (1 << bit))
+
+
+def write_csv(columns, path):
+    with open(path, "w", newline="") as file:
+        writer = csv.writer(file)
+        writer.writerow(COLUMNS + ("status_name", "event_names"))
+        for time, velocity, friction, status, events in zip(*columns):
+            # Values are float32, 7 significant digits round-trip them.
+            writer.writerow(("%.7g" % time, "%.7g" % velocity, "%.7g" % friction, status, events, status_name(status), event_names(events)))
+
+
+def write_parquet(columns, path):
+    try:
+        import pyarrow
+        import pyarrow.parquet
+    except ImportError:
+        raise SystemExit("Parquet output needs pyarrow: pip install pyarrow")
+
+    types = (pyarrow.float32(), pyarrow.float32(), pyarrow.float32(), pyarrow.uint8(), pyarrow.uint8())
+    table = pyarrow.table({
+        name: pyarrow.array(list(values), type=column_type)
+        for name, values, column_type in zip(COLUMNS, columns, types)
+    })
+    pyarrow.parquet.write_table(table, path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("files", nargs="+", help=".pmt files to convert")
+    parser.add_argument("--format", choices=("csv", "parquet"), default="csv")
+    parser.add_argument("--output-dir", help="defaults to the directory of each input file")
+    args = parser.parse_args()
+
+    for path in args.files:
+        columns = read_columns(path)
+        base_name = os.path.splitext(os.path.basename(path))[0] + "." + args.format
+        output_path = os.path.join(args.output_dir or os.path.dirname(path), base_name)
+        if args.format == "csv":
+            write_csv(columns, output_path)
+        else:
+            write_parquet(columns, output_path)
+        print("%s: %d samples -> %s" % (path, len(columns[0]), output_path))
+
+
+if __name__ == "__main__":
+    main()